@@ -0,0 +1,82 @@
+#include "camera.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace gl_wrappers;
+
+// View generation as it was done before the basis got cached: trig for direction
+// and up vectors is evaluated from scratch on every call
+static glm::mat4 uncached_view(camera const& cam) {
+    auto const sin_pitch{std::sin(cam.get_pitch())};
+    auto const cos_pitch{std::cos(cam.get_pitch())};
+    auto const sin_roll{std::sin(cam.get_roll())};
+    auto const cos_roll{std::cos(cam.get_roll())};
+    auto const sin_yaw{std::sin(cam.get_yaw())};
+    auto const cos_yaw{std::cos(cam.get_yaw())};
+
+    glm::vec3 const dir{sin_pitch * sin_roll, sin_pitch * cos_roll, cos_pitch};
+    glm::vec3 const up{sin_roll, cos_roll * cos_pitch, -sin_roll * sin_pitch};
+    auto const pos{cam.get_pos_vec()};
+
+    return glm::lookAt(pos,
+                       pos - glm::vec3{dir.x * cos_yaw - dir.z * sin_yaw, dir.y, dir.x * sin_yaw + dir.z * cos_yaw},
+                       glm::vec3{up.x * cos_yaw - up.z * sin_yaw, up.y, up.x * sin_yaw + up.z * cos_yaw});
+}
+
+template<typename FUNC>
+static void run(std::string const& name, unsigned long const iterations, FUNC&& func) {
+    float sink{0.f};
+
+    auto const start{std::chrono::steady_clock::now()};
+    for (unsigned long i{0}; i < iterations; ++i)
+        sink += func(i)[3][0];
+    auto const stop{std::chrono::steady_clock::now()};
+
+    auto const seconds{std::chrono::duration<double>(stop - start).count()};
+    std::cout << name << ": " << iterations / seconds / 1e6 << " M views/s (checksum " << sink << ')' << std::endl;
+}
+
+int main(int argc, char *argv[]) try {
+    unsigned long const iterations{argc > 1 ? std::stoul(argv[1]) : 10'000'000};
+
+    camera cam{glm::vec3{0.f, 0.f, 10.f}, 0.1, 0.2, 0.3};
+
+    run("uncached, static camera     ", iterations, [&](auto) { return uncached_view(cam); });
+    run("cached, static camera       ", iterations, [&](auto) { return cam.get_view(); });
+    run("cached, moving camera       ", iterations, [&](auto) {
+        cam.move_forward(1e-6f);
+        return cam.get_view();
+    });
+    run("cached, rotating camera     ", iterations, [&](auto i) {
+        cam.set_yaw(i * 1e-6);
+        return cam.get_view();
+    });
+    run("cached, 4 queries per frame ", iterations, [&](auto i) {
+        cam.set_yaw(i * 1e-6);
+        cam.get_direction_vec();
+        cam.get_up_vec();
+        cam.move_to_right(0.f);
+        return cam.get_view();
+    });
+
+    quat_camera qcam{glm::vec3{0.f, 0.f, 10.f}, 0.1, 0.2, 0.3};
+
+    run("quaternion, static camera   ", iterations, [&](auto) { return qcam.get_view(); });
+    run("quaternion, rotating camera ", iterations, [&](auto) {
+        qcam.rotate(1e-6, 0, 0);
+        return qcam.get_view();
+    });
+
+    return EXIT_SUCCESS;
+} catch (std::exception const& e) {
+    std::cerr << "Exception in main: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,95 @@
+#include "simd_culling.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+using namespace gl_helpers;
+
+template<typename FUNC>
+static double measure_ns(unsigned const iterations, FUNC&& func) {
+    double best{std::numeric_limits<double>::max()};
+
+    for (unsigned i{0}; i < iterations; ++i) {
+        auto const start{std::chrono::steady_clock::now()};
+        func();
+        auto const stop{std::chrono::steady_clock::now()};
+        best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count());
+    }
+
+    return best;
+}
+
+static void report(std::string const& name, double const ns, std::size_t const objects_cnt, std::size_t const visible_cnt) {
+    std::cout << name << ": " << ns / 1e6 << " ms, "
+              << ns / objects_cnt << " ns/object, "
+              << visible_cnt << " visible" << std::endl;
+}
+
+int main(int argc, char *argv[]) try {
+    std::size_t const objects_cnt{argc > 1 ? std::stoul(argv[1]) : 1'000'000};
+    constexpr unsigned iterations{20};
+
+    std::mt19937 gen{42};
+    std::uniform_real_distribution<float> pos_dist{-100.f, 100.f};
+    std::uniform_real_distribution<float> size_dist{0.1f, 2.f};
+
+    bounding_spheres spheres;
+    bounding_boxes boxes;
+    spheres.reserve(objects_cnt);
+    boxes.reserve(objects_cnt);
+
+    for (std::size_t i{0}; i < objects_cnt; ++i) {
+        glm::vec3 const center{pos_dist(gen), pos_dist(gen), pos_dist(gen)};
+        auto const size{size_dist(gen)};
+
+        spheres.push_back(center, size);
+        boxes.push_back(center - glm::vec3{size}, center + glm::vec3{size});
+    }
+
+    auto const view_projection{glm::perspective(glm::radians(45.f), 1.f, 0.1f, 100.f) *
+                               glm::lookAt(glm::vec3{0.f}, glm::vec3{0.f, 0.f, -1.f}, glm::vec3{0.f, 1.f, 0.f})};
+    auto const f{extract_frustum(view_projection)};
+
+    std::vector<std::uint32_t> visible;
+    visible.reserve(objects_cnt);
+
+    std::cout << objects_cnt << " objects, " << culling_lanes << " lanes" << std::endl;
+
+    auto const spheres_scalar_ns{measure_ns(iterations, [&] {
+        visible.clear();
+        cull_spheres_scalar(f, spheres, visible);
+    })};
+    report("spheres scalar", spheres_scalar_ns, objects_cnt, visible.size());
+    auto const scalar_spheres_visible{visible};
+
+    auto const spheres_simd_ns{measure_ns(iterations, [&] { cull_spheres(f, spheres, visible); })};
+    report("spheres simd  ", spheres_simd_ns, objects_cnt, visible.size());
+    if (visible != scalar_spheres_visible)
+        throw std::runtime_error("SIMD and scalar sphere culling results differ");
+
+    auto const boxes_scalar_ns{measure_ns(iterations, [&] {
+        visible.clear();
+        cull_boxes_scalar(f, boxes, visible);
+    })};
+    report("boxes scalar  ", boxes_scalar_ns, objects_cnt, visible.size());
+    auto const scalar_boxes_visible{visible};
+
+    auto const boxes_simd_ns{measure_ns(iterations, [&] { cull_boxes(f, boxes, visible); })};
+    report("boxes simd    ", boxes_simd_ns, objects_cnt, visible.size());
+    if (visible != scalar_boxes_visible)
+        throw std::runtime_error("SIMD and scalar box culling results differ");
+
+    return EXIT_SUCCESS;
+} catch (std::exception const& e) {
+    std::cerr << "Exception in main: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,64 @@
+# Asset archives: files packed by the asset_packer tool into one file, which
+# gl_helpers::asset_archive maps into memory and looks entries up in by name,
+# their paths relative to BASE_DIR.
+#
+#   add_asset_archive(<target> OUTPUT <file> BASE_DIR <dir> [COMPRESSION none|lz4|zstd] FILES <file>...)
+#
+# Entries may be compressed with LZ4 or zstd when the libraries are found, the
+# asset_codecs interface target carries them to the packer and to opengl_lib.
+
+find_path(LZ4_INCLUDE_DIR lz4.h)
+find_library(LZ4_LIBRARY lz4)
+find_path(ZSTD_INCLUDE_DIR zstd.h)
+find_library(ZSTD_LIBRARY zstd)
+
+add_library(asset_codecs INTERFACE)
+
+if(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+    set(ASSET_ARCHIVE_LZ4 ON)
+    target_include_directories(asset_codecs INTERFACE "${LZ4_INCLUDE_DIR}")
+    target_link_libraries(asset_codecs INTERFACE "${LZ4_LIBRARY}")
+    target_compile_definitions(asset_codecs INTERFACE GL_ASSET_ARCHIVE_LZ4)
+else()
+    message(STATUS "LZ4 not found, asset archives cannot use it")
+endif()
+
+if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    set(ASSET_ARCHIVE_ZSTD ON)
+    target_include_directories(asset_codecs INTERFACE "${ZSTD_INCLUDE_DIR}")
+    target_link_libraries(asset_codecs INTERFACE "${ZSTD_LIBRARY}")
+    target_compile_definitions(asset_codecs INTERFACE GL_ASSET_ARCHIVE_ZSTD)
+else()
+    message(STATUS "zstd not found, asset archives cannot use it")
+endif()
+
+function(add_asset_archive TARGET)
+    cmake_parse_arguments(ARG "" "OUTPUT;BASE_DIR;COMPRESSION" "FILES" ${ARGN})
+
+    # A missing codec only makes the archive bigger, it is not worth failing the build
+    if(NOT ARG_COMPRESSION)
+        set(ARG_COMPRESSION none)
+    elseif((ARG_COMPRESSION STREQUAL "lz4" AND NOT ASSET_ARCHIVE_LZ4) OR
+           (ARG_COMPRESSION STREQUAL "zstd" AND NOT ASSET_ARCHIVE_ZSTD))
+        message(STATUS "${TARGET}: ${ARG_COMPRESSION} is not available, assets are stored uncompressed")
+        set(ARG_COMPRESSION none)
+    endif()
+
+    get_filename_component(BASE_DIR "${ARG_BASE_DIR}" ABSOLUTE)
+
+    set(INPUTS)
+    foreach(FILE ${ARG_FILES})
+        get_filename_component(FILE "${FILE}" ABSOLUTE BASE_DIR "${BASE_DIR}")
+        list(APPEND INPUTS "${FILE}")
+    endforeach()
+
+    add_custom_command(
+        OUTPUT "${ARG_OUTPUT}"
+        COMMAND asset_packer "${ARG_OUTPUT}" "${BASE_DIR}" "--${ARG_COMPRESSION}" ${INPUTS}
+        DEPENDS asset_packer ${INPUTS}
+        COMMENT "Packing assets of ${TARGET}"
+        VERBATIM
+    )
+
+    add_custom_target(${TARGET} ALL DEPENDS "${ARG_OUTPUT}")
+endfunction()
@@ -0,0 +1,80 @@
+# Resource compiler: turns files into constexpr arrays of a generated
+# embedded_resources.hpp, found at run time by gl_helpers::find_resource()
+# under their paths relative to BASE_DIR, so loading them reads no files.
+#
+#   embed_resources(<target> BASE_DIR <dir> FILES <file>...)
+#
+# Included, this file defines the function; run with -P, it generates the header.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+    string(REPLACE "|" ";" FILES "${FILES}")
+
+    set(ARRAYS "")
+    set(ENTRIES "")
+    set(IDX 0)
+    foreach(FILE ${FILES})
+        file(READ "${FILE}" BYTES HEX)
+        string(LENGTH "${BYTES}" SIZE)
+        math(EXPR SIZE "${SIZE} / 2")
+
+        # Arrays cannot be empty, the size stays 0 though
+        if(SIZE EQUAL 0)
+            set(BYTES "00")
+        endif()
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${BYTES}")
+        # 16 bytes per line
+        string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)"
+               "\\1\n        " BYTES "${BYTES}")
+        string(REGEX REPLACE "\n        $" "" BYTES "${BYTES}")
+        file(RELATIVE_PATH NAME "${BASE_DIR}" "${FILE}")
+
+        string(APPEND ARRAYS "\n    // ${NAME}\n    inline constexpr unsigned char data_${IDX}[] = {\n        ${BYTES}\n    };\n")
+        string(APPEND ENTRIES "        {\"${NAME}\", data_${IDX}, ${SIZE}},\n")
+        math(EXPR IDX "${IDX} + 1")
+    endforeach()
+
+    file(WRITE "${OUTPUT}"
+         "// Generated by embed_resources.cmake, do not edit. Included by resource.hpp\n"
+         "#ifndef GL_EMBEDDED_RESOURCES__\n"
+         "#define GL_EMBEDDED_RESOURCES__\n\n"
+         "namespace gl_helpers::embedded_resources {\n"
+         "${ARRAYS}\n"
+         "    inline constexpr resource resources[] = {\n"
+         "${ENTRIES}"
+         "    };\n"
+         "}\n"
+         "#endif\n")
+    return()
+endif()
+
+set(EMBED_RESOURCES_SCRIPT "${CMAKE_CURRENT_LIST_FILE}")
+
+function(embed_resources TARGET)
+    cmake_parse_arguments(ARG "" "BASE_DIR" "FILES" ${ARGN})
+
+    set(OUTPUT_DIR "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}_resources")
+    set(OUTPUT "${OUTPUT_DIR}/embedded_resources.hpp")
+
+    set(INPUTS)
+    foreach(FILE ${ARG_FILES})
+        get_filename_component(FILE "${FILE}" ABSOLUTE BASE_DIR "${ARG_BASE_DIR}")
+        list(APPEND INPUTS "${FILE}")
+    endforeach()
+
+    # A list would be split into separate arguments of the command
+    string(REPLACE ";" "|" INPUTS_ARG "${INPUTS}")
+    get_filename_component(BASE_DIR "${ARG_BASE_DIR}" ABSOLUTE)
+
+    add_custom_command(
+        OUTPUT "${OUTPUT}"
+        COMMAND ${CMAKE_COMMAND} "-DOUTPUT=${OUTPUT}" "-DBASE_DIR=${BASE_DIR}" "-DFILES=${INPUTS_ARG}"
+                -P "${EMBED_RESOURCES_SCRIPT}"
+        DEPENDS ${INPUTS} "${EMBED_RESOURCES_SCRIPT}"
+        COMMENT "Embedding resources of ${TARGET}"
+        VERBATIM
+    )
+
+    target_sources(${TARGET} PRIVATE "${OUTPUT}")
+    target_include_directories(${TARGET} PRIVATE "${OUTPUT_DIR}")
+    target_compile_definitions(${TARGET} PRIVATE GL_EMBEDDED_RESOURCES)
+endfunction()
@@ -0,0 +1,506 @@
+#ifndef GL_ASSET_ARCHIVE__
+#define GL_ASSET_ARCHIVE__
+
+#include "resource.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GL_ASSET_ARCHIVE_MMAP
+#endif
+
+// Codecs are compiled in when CMake finds the libraries
+#ifdef GL_ASSET_ARCHIVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef GL_ASSET_ARCHIVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg) throw std::runtime_error(std::string{"Asset archive: "} + msg)
+
+namespace gl_helpers {
+
+    enum class asset_compression : std::uint8_t { none, lz4, zstd };
+
+    [[nodiscard]]
+    constexpr std::uint64_t fnv1a_hash(unsigned char const *const data, std::size_t const size) noexcept {
+        std::uint64_t hash{0xcbf29ce484222325ull};
+        for (std::size_t i{0}; i < size; ++i)
+            hash = (hash ^ data[i]) * 0x100000001b3ull;
+        return hash;
+    }
+
+    [[nodiscard]]
+    constexpr std::uint64_t fnv1a_hash(std::string_view const str) noexcept {
+        std::uint64_t hash{0xcbf29ce484222325ull};
+        for (auto const c : str)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        return hash;
+    }
+
+    // On disk layout, fields are in the byte order of the host, which is expected to be little endian:
+    //   header | entry data, each aligned to data_alignment | TOC sorted by name hash | names
+    // Uncompressed entries are handed out as views into the mapped file, so
+    // loading them copies nothing; compressed ones are decoded into a buffer.
+    namespace asset_archive_format {
+        inline constexpr char magic[4]{'G', 'L', 'P', 'K'};
+        inline constexpr std::uint32_t version{1};
+        inline constexpr std::size_t data_alignment{16};
+
+        struct header {
+            char magic[4];
+            std::uint32_t version;
+            std::uint32_t entries_cnt;
+            std::uint32_t reserved;
+            std::uint64_t toc_offset;
+            std::uint64_t names_offset;
+            std::uint64_t file_size;
+        };
+
+        struct toc_entry {
+            std::uint64_t name_hash;
+            std::uint64_t offset;
+            std::uint64_t stored_size;
+            std::uint64_t size;
+            // Of the uncompressed data
+            std::uint64_t content_hash;
+            std::uint32_t name_offset;
+            std::uint16_t name_size;
+            asset_compression compression;
+            std::uint8_t reserved;
+        };
+
+        static_assert(sizeof(header) == 40 && sizeof(toc_entry) == 48, "Archive structures must not be padded");
+    }
+
+    class asset_archive {
+    public:
+        // The data of one entry, either a view into the archive or a decoded copy.
+        // Views stay valid as long as the archive does.
+        class asset {
+        private:
+            std::vector<unsigned char> storage;
+            byte_view bytes;
+
+            friend class asset_archive;
+
+        public:
+            asset() = default;
+
+            // Moving keeps the buffer a decoded view points to, copying would not
+            asset(asset const&) = delete;
+            asset& operator=(asset const&) = delete;
+            asset(asset&&) noexcept = default;
+            asset& operator=(asset&&) noexcept = default;
+
+            [[nodiscard]]
+            byte_view get_bytes() const noexcept {
+                return bytes;
+            }
+
+            [[nodiscard]]
+            std::string_view get_text() const noexcept {
+                return bytes.get_text();
+            }
+        };
+
+    private:
+        using toc_entry = asset_archive_format::toc_entry;
+
+        byte_view file;
+        std::vector<unsigned char> file_copy;
+        asset_archive_format::header header{};
+
+        // Entries are copied out, as the mapping gives no alignment guarantees to the compiler
+        [[nodiscard]]
+        toc_entry get_entry(std::size_t const idx) const noexcept {
+            toc_entry entry;
+            std::memcpy(&entry, file.data() + header.toc_offset + idx * sizeof(toc_entry), sizeof(entry));
+            return entry;
+        }
+
+        [[nodiscard]]
+        std::string_view get_name(toc_entry const& entry) const noexcept {
+            return file.subview(header.names_offset + entry.name_offset, entry.name_size).get_text();
+        }
+
+        void map(std::string const& path) noexcept(false) {
+#ifdef GL_ASSET_ARCHIVE_MMAP
+            auto const fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (fd < 0)
+                GL_THROW_EXCEPTION_ON_ERROR("cannot open " + path);
+
+            struct stat st{};
+            void *ptr{MAP_FAILED};
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+                ptr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            // The mapping keeps the file open
+            close(fd);
+
+            if (ptr == MAP_FAILED)
+                GL_THROW_EXCEPTION_ON_ERROR("cannot map " + path);
+            file = {static_cast<unsigned char const*>(ptr), static_cast<std::size_t>(st.st_size)};
+#else
+            std::ifstream ifs{path, std::ios_base::binary};
+            ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+            file_copy.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            file = {file_copy.data(), file_copy.size()};
+#endif
+        }
+
+        void unmap() noexcept {
+#ifdef GL_ASSET_ARCHIVE_MMAP
+            if (file.data())
+                munmap(const_cast<unsigned char*>(file.data()), file.size());
+#endif
+            file = {};
+        }
+
+        [[nodiscard]]
+        static constexpr bool is_supported(asset_compression const compression) noexcept {
+            switch (compression) {
+                case asset_compression::none:
+                    return true;
+#ifdef GL_ASSET_ARCHIVE_LZ4
+                case asset_compression::lz4:
+                    return true;
+#endif
+#ifdef GL_ASSET_ARCHIVE_ZSTD
+                case asset_compression::zstd:
+                    return true;
+#endif
+                default:
+                    return false;
+            }
+        }
+
+        // Upper bound of the decoded to stored size ratio: an LZ4 match length grows by
+        // at most 255 bytes per byte, a zstd RLE block is at least 4 bytes for 128 KiB.
+        [[nodiscard]]
+        static constexpr std::uint64_t max_ratio(asset_compression const compression) noexcept {
+            switch (compression) {
+                case asset_compression::lz4:
+                    return 255;
+                case asset_compression::zstd:
+                    return 128 * 1024 / 4;
+                default:
+                    return 1;
+            }
+        }
+
+        void validate() const noexcept(false) {
+            using namespace asset_archive_format;
+
+            if (file.size() < sizeof(header) || std::memcmp(header.magic, magic, sizeof(magic)))
+                GL_THROW_EXCEPTION_ON_ERROR("not an asset archive");
+            if (header.version != version)
+                GL_THROW_EXCEPTION_ON_ERROR("unsupported version " + std::to_string(header.version));
+            if (header.file_size != file.size() || header.toc_offset < sizeof(header) ||
+                header.toc_offset > header.names_offset || header.names_offset > file.size() ||
+                (header.names_offset - header.toc_offset) / sizeof(toc_entry) < header.entries_cnt)
+                GL_THROW_EXCEPTION_ON_ERROR("truncated or corrupted archive");
+
+            // Bounds are checked by subtraction, sums of untrusted fields may wrap
+            auto const names_size{file.size() - header.names_offset};
+            for (std::size_t i{0}; i < header.entries_cnt; ++i) {
+                auto const entry{get_entry(i)};
+                if (entry.offset < sizeof(header) || entry.offset > header.toc_offset ||
+                    entry.stored_size > header.toc_offset - entry.offset ||
+                    entry.name_offset > names_size || entry.name_size > names_size - entry.name_offset)
+                    GL_THROW_EXCEPTION_ON_ERROR("entry " + std::to_string(i) + " is out of bounds");
+                if (!is_supported(entry.compression))
+                    GL_THROW_EXCEPTION_ON_ERROR("entry " + std::to_string(i) + " uses compression " +
+                                                std::to_string(static_cast<unsigned>(entry.compression)) +
+                                                " not supported by this build");
+                // Decoded size is allocated before decoding, so it must be bounded by the stored one
+                if (entry.compression == asset_compression::none
+                        ? entry.size != entry.stored_size
+                        : entry.size / max_ratio(entry.compression) > entry.stored_size)
+                    GL_THROW_EXCEPTION_ON_ERROR("entry " + std::to_string(i) + " has an invalid size");
+            }
+        }
+
+        [[nodiscard]]
+        static std::vector<unsigned char> decompress(toc_entry const& entry,
+                                                     [[maybe_unused]] byte_view const stored) noexcept(false) {
+            std::vector<unsigned char> data(entry.size);
+
+            switch (entry.compression) {
+#ifdef GL_ASSET_ARCHIVE_LZ4
+                case asset_compression::lz4:
+                    if (LZ4_decompress_safe(reinterpret_cast<char const*>(stored.data()),
+                                            reinterpret_cast<char*>(data.data()), static_cast<int>(stored.size()),
+                                            static_cast<int>(data.size())) != static_cast<int>(data.size()))
+                        GL_THROW_EXCEPTION_ON_ERROR("corrupted LZ4 entry");
+                    break;
+#endif
+#ifdef GL_ASSET_ARCHIVE_ZSTD
+                case asset_compression::zstd:
+                    if (ZSTD_decompress(data.data(), data.size(), stored.data(), stored.size()) != data.size())
+                        GL_THROW_EXCEPTION_ON_ERROR("corrupted zstd entry");
+                    break;
+#endif
+                default:
+                    GL_THROW_EXCEPTION_ON_ERROR("compression " +
+                                                std::to_string(static_cast<unsigned>(entry.compression)) +
+                                                " is not supported by this build");
+            }
+            return data;
+        }
+
+        [[nodiscard]]
+        asset load(toc_entry const& entry) const noexcept(false) {
+            auto const stored{file.subview(entry.offset, entry.stored_size)};
+
+            asset result;
+            if (entry.compression == asset_compression::none) {
+                result.bytes = stored;
+            } else {
+                result.storage = decompress(entry, stored);
+                result.bytes = {result.storage.data(), result.storage.size()};
+            }
+            return result;
+        }
+
+        // Index of the entry or entries_cnt if there is none
+        [[nodiscard]]
+        std::size_t find(std::string_view const name) const noexcept {
+            auto const hash{fnv1a_hash(name)};
+
+            // Binary search over the hashes, then a linear one over the colliding names
+            std::size_t lo{0}, hi{header.entries_cnt};
+            while (lo < hi) {
+                auto const mid{lo + (hi - lo) / 2};
+                if (get_entry(mid).name_hash < hash)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            for (; lo < header.entries_cnt; ++lo) {
+                auto const entry{get_entry(lo)};
+                if (entry.name_hash != hash)
+                    break;
+                if (get_name(entry) == name)
+                    return lo;
+            }
+            return header.entries_cnt;
+        }
+
+    public:
+        explicit asset_archive(std::string const& path) noexcept(false) {
+            map(path);
+
+            try {
+                if (file.size() >= sizeof(header))
+                    std::memcpy(&header, file.data(), sizeof(header));
+                validate();
+            } catch (...) {
+                unmap();
+                throw;
+            }
+        }
+
+        asset_archive(asset_archive const&) = delete;
+        asset_archive& operator=(asset_archive const&) = delete;
+
+        asset_archive(asset_archive&& o) noexcept
+                : file{std::exchange(o.file, {})}, file_copy{std::move(o.file_copy)}, header{o.header}
+        { }
+
+        asset_archive& operator=(asset_archive&& o) noexcept {
+            if (this == &o)
+                return *this;
+
+            unmap();
+            file = std::exchange(o.file, {});
+            file_copy = std::move(o.file_copy);
+            header = o.header;
+            return *this;
+        }
+
+        ~asset_archive() {
+            unmap();
+        }
+
+        [[nodiscard]]
+        std::size_t get_entries_cnt() const noexcept {
+            return header.entries_cnt;
+        }
+
+        [[nodiscard]]
+        bool contains(std::string_view const name) const noexcept {
+            return find(name) != header.entries_cnt;
+        }
+
+        [[nodiscard]]
+        asset load(std::string_view const name) const noexcept(false) {
+            auto const idx{find(name)};
+            if (idx == header.entries_cnt)
+                GL_THROW_EXCEPTION_ON_ERROR("no entry " + std::string{name});
+
+            return load(get_entry(idx));
+        }
+
+        // In the order of the TOC, views into the archive
+        [[nodiscard]]
+        std::vector<std::string_view> get_names() const {
+            std::vector<std::string_view> names;
+            for (std::size_t i{0}; i < header.entries_cnt; ++i)
+                names.push_back(get_name(get_entry(i)));
+            return names;
+        }
+
+        // Decodes every entry and checks its hash, loading does not to stay zero copy
+        [[nodiscard]]
+        bool verify() const noexcept(false) {
+            for (std::size_t i{0}; i < header.entries_cnt; ++i) {
+                auto const entry{get_entry(i)};
+                auto const asset{load(entry)};
+                auto const bytes{asset.get_bytes()};
+
+                if (bytes.size() != entry.size || fnv1a_hash(bytes.data(), bytes.size()) != entry.content_hash)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    // Builds an archive in memory and writes it out at once, used by the asset_packer tool
+    class asset_archive_writer {
+    private:
+        struct pending_entry {
+            std::string name;
+            std::vector<unsigned char> data;
+            asset_compression compression;
+        };
+
+        std::vector<pending_entry> entries;
+
+        [[nodiscard]]
+        static std::vector<unsigned char> compress([[maybe_unused]] std::vector<unsigned char> const& data,
+                                                   asset_compression const compression) noexcept(false) {
+            std::vector<unsigned char> compressed;
+
+            switch (compression) {
+#ifdef GL_ASSET_ARCHIVE_LZ4
+                case asset_compression::lz4: {
+                    compressed.resize(static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(data.size()))));
+                    auto const size{LZ4_compress_default(reinterpret_cast<char const*>(data.data()),
+                                                         reinterpret_cast<char*>(compressed.data()),
+                                                         static_cast<int>(data.size()),
+                                                         static_cast<int>(compressed.size()))};
+                    if (size <= 0)
+                        GL_THROW_EXCEPTION_ON_ERROR("LZ4 compression failed");
+                    compressed.resize(static_cast<std::size_t>(size));
+                    break;
+                }
+#endif
+#ifdef GL_ASSET_ARCHIVE_ZSTD
+                case asset_compression::zstd: {
+                    compressed.resize(ZSTD_compressBound(data.size()));
+                    auto const size{ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(),
+                                                  ZSTD_maxCLevel())};
+                    if (ZSTD_isError(size))
+                        GL_THROW_EXCEPTION_ON_ERROR(std::string{"zstd compression failed: "} + ZSTD_getErrorName(size));
+                    compressed.resize(size);
+                    break;
+                }
+#endif
+                default:
+                    GL_THROW_EXCEPTION_ON_ERROR("compression " + std::to_string(static_cast<unsigned>(compression)) +
+                                                " is not supported by this build");
+            }
+            return compressed;
+        }
+
+    public:
+        // Compressed data is kept only if it is smaller, already compressed
+        // formats such as PNG or JPEG end up stored as they are
+        void add(std::string name, std::vector<unsigned char> data,
+                 asset_compression const compression = asset_compression::none) noexcept(false) {
+            if (name.size() > UINT16_MAX)
+                GL_THROW_EXCEPTION_ON_ERROR("name is too long: " + name);
+            for (auto const& e : entries) {
+                if (e.name == name)
+                    GL_THROW_EXCEPTION_ON_ERROR("duplicate entry " + name);
+            }
+
+            entries.push_back({std::move(name), std::move(data), compression});
+        }
+
+        void write(std::string const& path) const noexcept(false) {
+            using namespace asset_archive_format;
+
+            std::vector<unsigned char> out(sizeof(header));
+            std::vector<toc_entry> toc;
+            std::string names;
+
+            for (auto const& e : entries) {
+                toc_entry entry{};
+                entry.name_hash = fnv1a_hash(e.name);
+                entry.size = e.data.size();
+                entry.content_hash = fnv1a_hash(e.data.data(), e.data.size());
+                if (names.size() > UINT32_MAX - e.name.size())
+                    GL_THROW_EXCEPTION_ON_ERROR("names of the entries exceed 4 GB");
+                entry.name_offset = static_cast<std::uint32_t>(names.size());
+                entry.name_size = static_cast<std::uint16_t>(e.name.size());
+                names += e.name;
+
+                std::vector<unsigned char> compressed;
+                if (e.compression != asset_compression::none)
+                    compressed = compress(e.data, e.compression);
+
+                auto const keep_compressed{!compressed.empty() && compressed.size() < e.data.size()};
+                auto const& stored{keep_compressed ? compressed : e.data};
+                entry.compression = keep_compressed ? e.compression : asset_compression::none;
+
+                out.resize((out.size() + data_alignment - 1) / data_alignment * data_alignment);
+                entry.offset = out.size();
+                entry.stored_size = stored.size();
+                out.insert(std::end(out), std::begin(stored), std::end(stored));
+                toc.push_back(entry);
+            }
+
+            std::stable_sort(std::begin(toc), std::end(toc),
+                             [](toc_entry const& lhs, toc_entry const& rhs) { return lhs.name_hash < rhs.name_hash; });
+
+            header h{};
+            std::memcpy(h.magic, magic, sizeof(magic));
+            h.version = version;
+            h.entries_cnt = static_cast<std::uint32_t>(toc.size());
+
+            out.resize((out.size() + data_alignment - 1) / data_alignment * data_alignment);
+            h.toc_offset = out.size();
+            out.resize(out.size() + toc.size() * sizeof(toc_entry));
+            if (!toc.empty())
+                std::memcpy(out.data() + h.toc_offset, toc.data(), toc.size() * sizeof(toc_entry));
+
+            h.names_offset = out.size();
+            out.insert(std::end(out), std::begin(names), std::end(names));
+            h.file_size = out.size();
+            std::memcpy(out.data(), &h, sizeof(h));
+
+            std::ofstream ofs{path, std::ios_base::binary};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+            ofs.write(reinterpret_cast<char const*>(out.data()), static_cast<std::streamsize>(out.size()));
+        }
+    };
+}
+#undef GL_THROW_EXCEPTION_ON_ERROR
+#undef GL_ASSET_ARCHIVE_MMAP
+#endif
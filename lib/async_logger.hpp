@@ -0,0 +1,265 @@
+#ifndef GL_ASYNC_LOGGER__
+#define GL_ASYNC_LOGGER__
+
+#include "spsc_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define GL_LOG(level, ...) gl_helpers::async_logger::get().log(gl_helpers::log_level::level, __VA_ARGS__)
+
+// Logs at most once per interval from this call site, reporting how many messages were skipped
+#define GL_LOG_EVERY(interval, level, ...)                                                              \
+do {                                                                                                    \
+    static gl_helpers::log_rate_limiter gl_log_rate_limiter{interval};                                  \
+    gl_helpers::async_logger::get().log(gl_log_rate_limiter, gl_helpers::log_level::level, __VA_ARGS__); \
+} while(0)
+
+namespace gl_helpers {
+
+    enum class log_level : std::uint8_t { debug, info, warning, error };
+
+    class log_rate_limiter {
+    private:
+        using steady_clock = std::chrono::steady_clock;
+
+        steady_clock::duration interval;
+        std::atomic<steady_clock::rep> next_allowed{0};
+        std::atomic<std::size_t> suppressed_cnt{0};
+
+    public:
+        template<typename REP, typename PERIOD>
+        explicit log_rate_limiter(std::chrono::duration<REP, PERIOD> const interval) noexcept
+                : interval{std::chrono::duration_cast<steady_clock::duration>(interval)}
+        { }
+
+        bool allow() noexcept {
+            auto const now{steady_clock::now().time_since_epoch().count()};
+            auto next{next_allowed.load(std::memory_order_relaxed)};
+
+            if (now < next || !next_allowed.compare_exchange_strong(next, now + interval.count(),
+                                                                    std::memory_order_relaxed)) {
+                suppressed_cnt.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+        std::size_t take_suppressed_cnt() noexcept {
+            return suppressed_cnt.exchange(0, std::memory_order_relaxed);
+        }
+    };
+
+    // Messages are formatted on the calling thread into a fixed size record and
+    // pushed into a lock-free queue owned by that thread. A background thread
+    // drains all the queues and writes them out in batches, flushing once per
+    // batch, so logging from a frame loop costs neither a syscall nor a lock.
+    // Messages below the level are discarded before formatting; messages not
+    // fitting into the queue are dropped and counted.
+    class async_logger {
+    public:
+        static constexpr std::size_t message_size{256};
+        static constexpr std::size_t queue_capacity{1024};
+        static constexpr std::chrono::milliseconds flush_interval{50};
+
+    private:
+        using steady_clock = std::chrono::steady_clock;
+
+        struct message {
+            steady_clock::time_point time;
+            log_level level;
+            std::size_t thread_id;
+            char text[message_size];
+        };
+
+        struct thread_queue {
+            spsc_queue<message, queue_capacity> queue;
+            std::size_t id;
+
+            explicit thread_queue(std::size_t const id) : id{id} { }
+        };
+
+        // Stream writing into a caller supplied buffer, truncating what does not fit
+        class fixed_buffer : public std::streambuf {
+        public:
+            void reset(char *const begin, std::size_t const size) {
+                setp(begin, begin + size);
+            }
+
+            [[nodiscard]]
+            std::size_t get_size() const {
+                return static_cast<std::size_t>(pptr() - pbase());
+            }
+        };
+
+        std::mutex mutex;
+        std::condition_variable flush_cv;
+        std::vector<std::shared_ptr<thread_queue>> queues;
+        std::ostream *output{&std::clog};
+        bool stopping{false};
+
+        std::atomic<log_level> min_level{log_level::info};
+        std::atomic<bool> urgent{false};
+        std::atomic<std::size_t> dropped_cnt{0};
+        steady_clock::time_point const start{steady_clock::now()};
+
+        std::vector<message> batch;
+        std::thread flusher;
+
+        async_logger() : flusher{[this] { flush_loop(); }} { }
+
+        thread_queue& get_thread_queue() {
+            thread_local std::shared_ptr<thread_queue> const queue{[this] {
+                std::lock_guard<std::mutex> const lock{mutex};
+                queues.push_back(std::make_shared<thread_queue>(queues.size() + 1));
+                return queues.back();
+            }()};
+
+            return *queue;
+        }
+
+        static char const* level_name(log_level const level) noexcept {
+            switch (level) {
+                case log_level::debug:
+                    return "debug";
+                case log_level::info:
+                    return "info";
+                case log_level::warning:
+                    return "warning";
+                default:
+                    return "error";
+            }
+        }
+
+        // Has to be called with the mutex locked
+        void drain() {
+            for (auto const& queue : queues)
+                queue->queue.consume_all([this](message const& msg) { batch.push_back(msg); });
+
+            if (batch.empty())
+                return;
+
+            // Queues are drained one after another, restore the global order
+            std::stable_sort(std::begin(batch), std::end(batch),
+                             [](message const& lhs, message const& rhs) { return lhs.time < rhs.time; });
+
+            auto& os{*output};
+            for (auto const& msg : batch) {
+                std::chrono::duration<double> const time{msg.time - start};
+
+                char prefix[64];
+                std::snprintf(prefix, sizeof(prefix), "[%9.3f] [T%zu] [%s] ", time.count(), msg.thread_id,
+                              level_name(msg.level));
+                os << prefix << msg.text << '\n';
+            }
+            os.flush();
+            batch.clear();
+        }
+
+        void flush_loop() {
+            std::unique_lock<std::mutex> lock{mutex};
+
+            while (!stopping) {
+                flush_cv.wait_for(lock, flush_interval, [this] { return stopping || urgent.load(); });
+                urgent = false;
+                drain();
+            }
+        }
+
+    public:
+        async_logger(async_logger const&) = delete;
+        async_logger& operator=(async_logger const&) = delete;
+
+        // Writes out everything logged before
+        ~async_logger() {
+            {
+                std::lock_guard<std::mutex> const lock{mutex};
+                stopping = true;
+            }
+            flush_cv.notify_one();
+            flusher.join();
+
+            std::lock_guard<std::mutex> const lock{mutex};
+            drain();
+        }
+
+        static async_logger& get() {
+            static async_logger logger;
+            return logger;
+        }
+
+        void set_level(log_level const level) noexcept {
+            min_level.store(level, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]]
+        bool is_enabled(log_level const level) const noexcept {
+            return level >= min_level.load(std::memory_order_relaxed);
+        }
+
+        // The stream has to outlive the logger or be replaced before destruction
+        void set_output(std::ostream& os) {
+            std::lock_guard<std::mutex> const lock{mutex};
+            drain();
+            output = &os;
+        }
+
+        [[nodiscard]]
+        std::size_t get_dropped_cnt() const noexcept {
+            return dropped_cnt.load(std::memory_order_relaxed);
+        }
+
+        template<typename... ARGS>
+        void log(log_level const level, ARGS&&... args) {
+            if (!is_enabled(level))
+                return;
+
+            thread_local fixed_buffer buffer;
+            thread_local std::ostream os{&buffer};
+
+            message msg;
+            buffer.reset(msg.text, message_size - 1);
+            os.clear();
+            (os << ... << std::forward<ARGS>(args));
+            msg.text[buffer.get_size()] = '\0';
+
+            auto& queue{get_thread_queue()};
+            msg.time = steady_clock::now();
+            msg.level = level;
+            msg.thread_id = queue.id;
+
+            if (!queue.queue.push(msg)) {
+                dropped_cnt.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            if (level == log_level::error) {
+                urgent = true;
+                flush_cv.notify_one();
+            }
+        }
+
+        template<typename... ARGS>
+        void log(log_rate_limiter& limiter, log_level const level, ARGS&&... args) {
+            if (!is_enabled(level) || !limiter.allow())
+                return;
+
+            if (auto const suppressed{limiter.take_suppressed_cnt()})
+                log(level, std::forward<ARGS>(args)..., " (", suppressed, " more suppressed)");
+            else
+                log(level, std::forward<ARGS>(args)...);
+        }
+    };
+}
+#endif
@@ -0,0 +1,326 @@
+#ifndef GL_BENCH_HARNESS__
+#define GL_BENCH_HARNESS__
+
+#include "gl_wrappers.hpp"
+#include "gl_clock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Runs a demo for a fixed number of frames on a simulated clock, which advances
+    // by a constant step per frame, so every run renders exactly the same frames.
+    // CPU time, GPU time and the frame_stats counters of every frame are written out as JSON.
+    // Without --bench-frames the harness is disabled: the clock is the real one
+    // and nothing is recorded.
+    // Either way the harness owns the frame clock, which may also be replayed from
+    // or recorded to a file, and ticks it in begin_frame().
+    // Headless runs also report how many pixels of the last frame were drawn
+    // and fail when it holds nothing but the clear color.
+    class bench_harness {
+    public:
+        static constexpr double default_time_step{1. / 60.};
+
+        // Queries created up front, more are added while the GPU lags further behind
+        static constexpr std::size_t queries_cnt{4};
+
+    private:
+        using steady_clock = std::chrono::steady_clock;
+
+        struct frame_record {
+            double cpu_ms;
+            double gpu_ms;
+            frame_counters counters;
+        };
+
+        struct summary {
+            double min, avg, p50, p99, max;
+        };
+
+        std::string scene;
+        std::size_t frames_cnt{0};
+        double time_step{default_time_step};
+        std::string out_path;
+        std::string clock_record_path;
+
+        std::unique_ptr<clock> frame_clock;
+
+        std::size_t frame_idx{0};
+        steady_clock::time_point frame_start{};
+        std::vector<frame_record> records;
+
+        struct pending_query {
+            std::size_t frame;
+            query_object query;
+        };
+
+        // Created on the first frame, as the harness may be constructed before the context
+        std::vector<query_object> free_queries;
+        // Queries of frames whose GPU time is not read yet, oldest first
+        std::deque<pending_query> pending_queries;
+        bool queries_created{false};
+
+        // Reads the results of pending queries, without wait only those already available.
+        // Queries complete in submission order, so the first unavailable one ends the scan.
+        void collect_gpu_times(bool const wait) {
+            while (!pending_queries.empty()) {
+                auto& pending{pending_queries.front()};
+
+                if (!wait) {
+                    GLint available{GL_FALSE};
+                    glGetQueryObjectiv(pending.query.get_id(), GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (!available)
+                        return;
+                }
+
+                GLuint64 elapsed_ns;
+                glGetQueryObjectui64v(pending.query.get_id(), GL_QUERY_RESULT, &elapsed_ns);
+                records[pending.frame].gpu_ms = static_cast<double>(elapsed_ns) * 1e-6;
+
+                free_queries.push_back(std::move(pending.query));
+                pending_queries.pop_front();
+            }
+        }
+
+        template<typename FIELD>
+        summary summarize(FIELD const field) const {
+            std::vector<double> values;
+            values.reserve(records.size());
+            for (auto const& record : records)
+                values.push_back(record.*field);
+
+            if (values.empty())
+                return {};
+
+            std::sort(std::begin(values), std::end(values));
+            auto percentile = [&values](double const p) {
+                return values[static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5)];
+            };
+
+            double sum{0.};
+            for (auto const value : values)
+                sum += value;
+
+            return {values.front(), sum / static_cast<double>(values.size()),
+                    percentile(0.5), percentile(0.99), values.back()};
+        }
+
+        static char const* backend_name(glfw::backend const b) noexcept {
+            switch (b) {
+                case glfw::backend::headless_egl:
+                    return "egl";
+                case glfw::backend::headless_osmesa:
+                    return "osmesa";
+                default:
+                    return "window";
+            }
+        }
+
+        // Pixels differing from the bottom left one, 0 if the frame is a single color
+        static std::size_t count_drawn_pixels(std::vector<std::uint8_t> const& pixels) noexcept {
+            std::size_t drawn{0};
+            for (std::size_t i{4}; i + 4 <= pixels.size(); i += 4)
+                drawn += !std::equal(&pixels[i], &pixels[i] + 4, pixels.data());
+            return drawn;
+        }
+
+        static void write_summary(std::ostream& os, char const *const name, summary const& s) {
+            os << "  \"" << name << "\": {\"min\": " << s.min << ", \"avg\": " << s.avg << ", \"p50\": " << s.p50 <<
+                  ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "},\n";
+        }
+
+    public:
+        // Recognized options: --bench-frames N, --bench-out FILE, --bench-step SECONDS,
+        // --clock-replay FILE, --clock-record FILE. Other arguments are left to the demo.
+        bench_harness(std::string scene, int const argc, char const* const argv[]) noexcept(false)
+                : scene{std::move(scene)}, out_path{this->scene + ".json"}
+        {
+            std::string clock_replay_path;
+
+            for (int i{1}; i < argc; ++i) {
+                if (!get_option_args_cnt(argv[i]))
+                    continue;
+
+                if (i + 1 == argc)
+                    throw std::runtime_error("Missing value for "s + argv[i]);
+
+                std::string const option{argv[i]}, value{argv[++i]};
+                if (option == "--bench-frames")
+                    frames_cnt = std::stoul(value);
+                else if (option == "--bench-out")
+                    out_path = value;
+                else if (option == "--bench-step")
+                    time_step = std::stod(value);
+                else if (option == "--clock-replay")
+                    clock_replay_path = value;
+                else
+                    clock_record_path = value;
+            }
+
+            if (!clock_replay_path.empty())
+                frame_clock = replay_clock::from_file(clock_replay_path);
+            else if (is_enabled())
+                frame_clock = std::make_unique<fixed_step_clock>(time_step);
+            else
+                frame_clock = std::make_unique<real_clock>();
+
+            if (!clock_record_path.empty())
+                frame_clock = std::make_unique<recording_clock>(std::move(frame_clock));
+
+            records.reserve(frames_cnt);
+        }
+
+        bench_harness(bench_harness const&) = delete;
+        bench_harness& operator=(bench_harness const&) = delete;
+
+        // Number of argv entries taken by the harness option, 0 if arg is not one
+        static int get_option_args_cnt(char const *const arg) noexcept {
+            std::string const option{arg};
+            return option == "--bench-frames" || option == "--bench-out" || option == "--bench-step" ||
+                   option == "--clock-replay" || option == "--clock-record" ? 2 : 0;
+        }
+
+        [[nodiscard]]
+        inline bool is_enabled() const noexcept {
+            return frames_cnt != 0;
+        }
+
+        [[nodiscard]]
+        inline bool is_done() const noexcept {
+            return is_enabled() && frame_idx >= frames_cnt;
+        }
+
+        // Time of the current frame, sampled once in begin_frame()
+        [[nodiscard]]
+        inline double get_time() const noexcept {
+            return frame_clock->get_time();
+        }
+
+        [[nodiscard]]
+        inline clock const& get_clock() const noexcept {
+            return *frame_clock;
+        }
+
+        void begin_frame() noexcept(false) {
+            frame_clock->tick();
+
+            if (!is_enabled())
+                return;
+
+            if (!queries_created) {
+                free_queries.reserve(queries_cnt);
+                for (std::size_t i{0}; i < queries_cnt; ++i)
+                    free_queries.emplace_back("bench frame time");
+                queries_created = true;
+            }
+
+            // Never blocks on the GPU, a query still in flight just is not reused yet
+            collect_gpu_times(false);
+            if (free_queries.empty())
+                free_queries.emplace_back("bench frame time");
+
+            frame_start = steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, free_queries.back().get_id());
+        }
+
+        // Call right after the swap, so presenting is accounted to the frame.
+        // Rolls frame_stats over even when disabled.
+        void end_frame() noexcept(false) {
+            frame_stats::end_frame();
+
+            if (!is_enabled())
+                return;
+
+            glEndQuery(GL_TIME_ELAPSED);
+            std::chrono::duration<double, std::milli> const cpu_time{steady_clock::now() - frame_start};
+            records.push_back({cpu_time.count(), 0., frame_stats::get_last()});
+            pending_queries.push_back({frame_idx, std::move(free_queries.back())});
+            free_queries.pop_back();
+            ++frame_idx;
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to measure frame");
+        }
+
+        // Waits for outstanding GPU timings and writes the report and the clock recording.
+        // Has to be called with the context still current.
+        void finish() noexcept(false) {
+            if (!clock_record_path.empty())
+                static_cast<recording_clock const&>(*frame_clock).save(clock_record_path);
+
+            if (!is_enabled() || !queries_created)
+                return;
+
+            auto const recorded{records.size()};
+            collect_gpu_times(true);
+
+            pending_queries.clear();
+            free_queries.clear();
+            queries_created = false;
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to collect GPU timings");
+
+            // Nobody looks at a headless run, so check the last frame is more than the clear color
+            std::optional<std::size_t> drawn_pixels;
+            if (auto const window{glfw::get_context().lock()}) {
+                if (auto const offscreen{window->get_offscreen_framebuffer()})
+                    drawn_pixels = count_drawn_pixels(offscreen->read_pixels());
+            }
+
+            std::ofstream ofs{out_path};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+            frame_counters totals;
+            for (auto const& record : records) {
+                totals.draw_calls += record.counters.draw_calls;
+                totals.triangles += record.counters.triangles;
+                totals.state_changes += record.counters.state_changes;
+                totals.uploaded_bytes += record.counters.uploaded_bytes;
+            }
+
+            ofs << "{\n"
+                   "  \"scene\": \"" << scene << "\",\n"
+                   "  \"backend\": \"" << backend_name(glfw::get_backend()) << "\",\n"
+                   "  \"frames\": " << recorded << ",\n"
+                   "  \"time_step\": " << time_step << ",\n"
+                   "  \"draw_calls\": " << totals.draw_calls << ",\n"
+                   "  \"triangles\": " << totals.triangles << ",\n"
+                   "  \"state_changes\": " << totals.state_changes << ",\n"
+                   "  \"uploaded_bytes\": " << totals.uploaded_bytes << ",\n";
+            if (drawn_pixels)
+                ofs << "  \"drawn_pixels\": " << *drawn_pixels << ",\n";
+            write_summary(ofs, "cpu_ms", summarize(&frame_record::cpu_ms));
+            write_summary(ofs, "gpu_ms", summarize(&frame_record::gpu_ms));
+
+            ofs << "  \"per_frame\": [";
+            for (std::size_t i{0}; i < recorded; ++i) {
+                auto const& record{records[i]};
+                ofs << (i ? ",\n" : "\n") << "    {\"cpu_ms\": " << record.cpu_ms << ", \"gpu_ms\": " <<
+                       record.gpu_ms << ", \"draw_calls\": " << record.counters.draw_calls <<
+                       ", \"triangles\": " << record.counters.triangles <<
+                       ", \"state_changes\": " << record.counters.state_changes <<
+                       ", \"uploaded_bytes\": " << record.counters.uploaded_bytes << '}';
+            }
+            ofs << "\n  ]\n}\n";
+
+            if (drawn_pixels == std::size_t{0})
+                throw std::runtime_error("Nothing was drawn into the offscreen framebuffer of " + scene);
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
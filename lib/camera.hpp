@@ -0,0 +1,456 @@
+#ifndef GL_CAMERA__
+#define GL_CAMERA__
+
+#include "gl_wrappers.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include <bitset>
+#include <iostream>
+#include <utility>
+
+namespace gl_wrappers {
+
+    using radian = double;
+
+    inline std::ostream &operator <<(std::ostream &o, glm::vec3 const &vec3) {
+        return o << '(' << vec3.x << ", " << vec3.y << ", " << vec3.z << ')';
+    }
+
+    // Input callbacks shared by all camera implementations. CAMERA is expected to
+    // provide get_fov/set_fov, rotate(yaw, pitch, roll) deltas and move_* methods.
+    template<typename CAMERA>
+    class camera_scroll_callback final : public glfw_scroll_callback {
+    private:
+        CAMERA& cam;
+    public:
+        camera_scroll_callback(CAMERA& cam) : cam{cam}{};
+
+        virtual void operator() (glfw_window&, double, double y_off ) {
+            constexpr auto max_fov{M_PI_2};
+            constexpr auto min_fov{M_PI_2 / 180};
+
+            auto fov_new{cam.get_fov() - glm::radians(y_off)};
+
+            if (fov_new > max_fov)
+                fov_new = max_fov;
+            else if( fov_new < min_fov)
+                fov_new = min_fov;
+
+            cam.set_fov(fov_new);
+        }
+    };
+
+    // Callback only records which keys are held, camera is moved by update()
+    // once per frame, so motion depends on frame time and not on key repeat rate
+    template<typename CAMERA>
+    class camera_key_callback final : public glfw_key_callback {
+    private:
+        CAMERA& cam;
+        std::bitset<GLFW_KEY_LAST + 1> pressed_keys;
+
+        static constexpr float move_speed{3.f}; // units per second
+        static constexpr float roll_speed{2.f}; // radians per second
+
+        inline float axis(int const positive_key, int const negative_key) const noexcept {
+            return static_cast<float>(pressed_keys[positive_key]) - static_cast<float>(pressed_keys[negative_key]);
+        }
+
+    public:
+        camera_key_callback(CAMERA& cam) : cam{cam}{};
+
+        virtual void operator() (glfw_window& window, int key, [[maybe_unused]]int scan_code, int action, [[maybe_unused]]int mode)
+        {
+            if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+                window.set_should_be_closed(true);
+
+            if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT)
+                return;
+
+            pressed_keys[key] = action == GLFW_PRESS;
+        }
+
+        [[nodiscard]]
+        bool is_pressed(int const key) const noexcept {
+            return pressed_keys[key];
+        }
+
+        void update(double const delta_time) {
+            auto const forward{axis(GLFW_KEY_W, GLFW_KEY_S)};
+            auto const right{axis(GLFW_KEY_A, GLFW_KEY_D)};
+            auto const roll{axis(GLFW_KEY_Q, GLFW_KEY_E)};
+
+            // Moving diagonally must not be faster than along a single axis
+            auto const norm{forward != 0.f && right != 0.f ? 1.f / std::sqrt(2.f) : 1.f};
+            auto const step{static_cast<float>(move_speed * delta_time) * norm};
+
+            if (forward != 0.f)
+                cam.move_forward(forward * step);
+            if (right != 0.f)
+                cam.move_to_right(right * step);
+            if (roll != 0.f)
+                cam.rotate(0, 0, roll * roll_speed * delta_time);
+        }
+    };
+
+    template<typename CAMERA>
+    class camera_cursor_pos_callback final : public glfw_cursor_pos_callback {
+    private:
+        CAMERA& cam;
+
+        double prev_x_pos{};
+        double prev_y_pos{};
+        bool call_once{true};
+
+        static constexpr float sensitivity{0.005f};
+    public:
+        camera_cursor_pos_callback(CAMERA& cam) : cam{cam}{};
+
+        virtual void operator() (glfw_window&,  double x_pos, double y_pos)
+        {
+            if (call_once) {
+                prev_x_pos = x_pos;
+                prev_y_pos = y_pos;
+                call_once = false;
+            }
+
+            double const x_off{sensitivity * (x_pos - prev_x_pos)};
+            double const y_off{sensitivity * (prev_y_pos - y_pos)};
+
+            cam.rotate(x_off, -y_off, 0);
+
+            prev_x_pos = x_pos;
+            prev_y_pos = y_pos;
+        }
+    };
+
+    // Handler for glfw::poll_events(handler) feeding a camera without virtual
+    // calls: the callbacks are final, so calling them directly is resolved statically
+    template<typename CAMERA>
+    struct camera_input {
+        CAMERA& cam;
+
+        void on_key(glfw_window& window, int const key, int const scan_code, int const action, int const mode) {
+            cam.key_callback(window, key, scan_code, action, mode);
+        }
+
+        void on_cursor_pos(glfw_window& window, double const x_pos, double const y_pos) {
+            cam.cursor_pos_callback(window, x_pos, y_pos);
+        }
+
+        void on_scroll(glfw_window& window, double const x_off, double const y_off) {
+            cam.scroll_callback(window, x_off, y_off);
+        }
+    };
+
+    class camera {
+    private:
+        glm::vec3 position;
+        radian pitch;
+        radian yaw;
+        radian roll;
+        radian fov;
+
+        // Orientation vectors and the view matrix are derived lazily and only
+        // after the state they depend on has been changed, so querying them
+        // several times per frame costs nothing
+        struct basis {
+            glm::vec3 direction;
+            glm::vec3 up;
+            glm::vec3 right;
+        };
+
+        mutable basis cached_basis{};
+        mutable glm::mat4 cached_view{1.f};
+        mutable bool basis_dirty{true};
+        mutable bool view_dirty{true};
+
+        void invalidate_orientation() noexcept {
+            basis_dirty = true;
+            view_dirty = true;
+        }
+
+        basis const& get_basis() const {
+            if (!basis_dirty)
+                return cached_basis;
+
+            auto const sin_pitch{std::sin(pitch)};
+            auto const cos_pitch{std::cos(pitch)};
+            auto const cos_roll{std::cos(roll)};
+            auto const sin_roll{std::sin(roll)};
+            auto const cos_yaw{std::cos(yaw)};
+            auto const sin_yaw{std::sin(yaw)};
+
+            auto rotate_yaw = [cos_yaw, sin_yaw](glm::vec3 const& vec) {
+                return glm::vec3{vec.x * cos_yaw - vec.z * sin_yaw,
+                                 vec.y,
+                                 vec.x * sin_yaw + vec.z * cos_yaw};
+            };
+
+            cached_basis.direction = rotate_yaw({sin_pitch * sin_roll,
+                                                 sin_pitch * cos_roll,
+                                                 cos_pitch});
+            cached_basis.up = rotate_yaw({sin_roll,
+                                          cos_roll * cos_pitch,
+                                          -sin_roll * sin_pitch});
+            cached_basis.right = glm::cross(cached_basis.up, cached_basis.direction);
+
+            basis_dirty = false;
+            return cached_basis;
+        }
+
+    public:
+
+        template<typename T>
+        explicit camera(T&& start_pos = {}, radian pitch = 0.f, radian yaw = 0.f, radian roll = 0.f, radian fov = M_PI_2 / 2)
+                : position{std::forward<T>(start_pos)}, pitch{pitch}, yaw{yaw}, roll{roll}, fov{fov} {
+        }
+
+        radian get_fov() const {
+            return fov;
+        }
+
+        void set_fov(radian value) {
+            fov = value;
+        }
+
+        glm::vec3 get_pos_vec() const {
+            return position;
+        }
+
+        void set_pos_vec(glm::vec3 const& pos) {
+            position = pos;
+            view_dirty = true;
+        }
+
+        void set_pitch(radian value) {
+            constexpr auto max{M_PI_2};
+            constexpr auto min{-M_PI_2};
+            if( min < value && value < max && value != pitch) {
+                pitch = value;
+                invalidate_orientation();
+            }
+        }
+
+        radian get_pitch() const {
+            return pitch;
+        }
+
+        void set_yaw(radian value) {
+            if (value != yaw) {
+                yaw = value;
+                invalidate_orientation();
+            }
+        }
+
+        radian get_yaw() const {
+            return yaw;
+        }
+
+        void set_roll(radian value) {
+            if (value != roll) {
+                roll = value;
+                invalidate_orientation();
+            }
+        }
+
+        radian get_roll() const {
+            return roll;
+        }
+
+        glm::vec3 get_direction_vec() const {
+            return get_basis().direction;
+        }
+
+        glm::vec3 get_up_vec() const {
+            return get_basis().up;
+        }
+
+        glm::vec3 get_right_vec() const {
+            return get_basis().right;
+        }
+
+        void move_forward(float speed) {
+            set_pos_vec(get_pos_vec() - speed * get_direction_vec());
+        }
+
+        void move_backward(float speed) {
+            move_forward(-speed);
+        }
+
+        void move_to_right(float speed) {
+            set_pos_vec(get_pos_vec() - speed * get_right_vec());
+        }
+
+        void move_to_left(float speed) {
+            move_to_right(-speed);
+        }
+
+        void rotate(radian const yaw_delta, radian const pitch_delta, radian const roll_delta) {
+            set_yaw(get_yaw() + yaw_delta);
+            set_pitch(get_pitch() + pitch_delta);
+            set_roll(get_roll() + roll_delta);
+        }
+
+        camera_scroll_callback<camera> scroll_callback{*this};
+        camera_key_callback<camera> key_callback{*this};
+        camera_cursor_pos_callback<camera> cursor_pos_callback{*this};
+
+        // Integrates movement of held keys, expected to be called once per frame
+        void update(double const delta_time) {
+            key_callback.update(delta_time);
+        }
+
+        glm::mat4 const& get_view() const {
+            if (view_dirty) {
+                auto const& cam_basis{get_basis()};
+                cached_view = glm::lookAt(position, position - cam_basis.direction, cam_basis.up);
+                view_dirty = false;
+            }
+
+            return cached_view;
+        }
+    };
+
+    inline std::ostream &operator <<(std::ostream &o, camera const &cam) {
+        return o << "pos = " << cam.get_pos_vec() <<
+                  "; direction = " << cam.get_direction_vec() <<
+                  "; up = " << cam.get_up_vec() <<
+                  "; roll = " << glm::degrees(cam.get_roll()) <<
+                  "; pitch = " << glm::degrees(cam.get_pitch()) <<
+                  "; yaw = " << glm::degrees(cam.get_yaw()) <<
+                  "; fov = " << glm::degrees(cam.get_fov());
+    }
+
+    // Orientation is kept as a unit quaternion and updated incrementally by
+    // rotate(), so no trig is evaluated per query or per input event. Unlike
+    // camera there is no pitch limit: the quaternion has no gimbal lock to avoid.
+    class quat_camera {
+    private:
+        // Rounding error accumulated by incremental updates is removed this often
+        static constexpr unsigned renormalize_period{64};
+
+        glm::quat orientation;
+        glm::vec3 position;
+        float fov;
+        unsigned updates_cnt{0};
+
+        mutable glm::mat4 cached_view{1.f};
+        mutable bool view_dirty{true};
+
+        static glm::quat from_euler(radian const pitch, radian const yaw, radian const roll) {
+            // Signs follow the camera conventions: positive yaw turns right,
+            // positive pitch turns down and positive roll tilts to the left
+            return glm::angleAxis(static_cast<float>(-yaw), glm::vec3{0.f, 1.f, 0.f}) *
+                   glm::angleAxis(static_cast<float>(-pitch), glm::vec3{1.f, 0.f, 0.f}) *
+                   glm::angleAxis(static_cast<float>(-roll), glm::vec3{0.f, 0.f, 1.f});
+        }
+
+    public:
+        template<typename T>
+        explicit quat_camera(T&& start_pos = {}, radian pitch = 0.f, radian yaw = 0.f, radian roll = 0.f, radian fov = M_PI_2 / 2)
+                : orientation{from_euler(pitch, yaw, roll)}, position{std::forward<T>(start_pos)},
+                  fov{static_cast<float>(fov)} {
+        }
+
+        radian get_fov() const {
+            return fov;
+        }
+
+        void set_fov(radian value) {
+            fov = static_cast<float>(value);
+        }
+
+        glm::vec3 get_pos_vec() const {
+            return position;
+        }
+
+        void set_pos_vec(glm::vec3 const& pos) {
+            position = pos;
+            view_dirty = true;
+        }
+
+        glm::quat get_orientation() const {
+            return orientation;
+        }
+
+        // Opposite to the look direction, as camera::get_direction_vec()
+        glm::vec3 get_direction_vec() const {
+            return orientation * glm::vec3{0.f, 0.f, 1.f};
+        }
+
+        glm::vec3 get_up_vec() const {
+            return orientation * glm::vec3{0.f, 1.f, 0.f};
+        }
+
+        glm::vec3 get_right_vec() const {
+            return orientation * glm::vec3{1.f, 0.f, 0.f};
+        }
+
+        void move_forward(float speed) {
+            set_pos_vec(get_pos_vec() - speed * get_direction_vec());
+        }
+
+        void move_backward(float speed) {
+            move_forward(-speed);
+        }
+
+        void move_to_right(float speed) {
+            set_pos_vec(get_pos_vec() - speed * get_right_vec());
+        }
+
+        void move_to_left(float speed) {
+            move_to_right(-speed);
+        }
+
+        // Yaw turns around the world up axis, as camera does, so looking around
+        // never accumulates roll; pitch and roll turn around the camera local axes.
+        // Per-event deltas are small, so angleAxis here is the only trig left and
+        // it runs once per update.
+        void rotate(radian const yaw_delta, radian const pitch_delta, radian const roll_delta) {
+            orientation = glm::angleAxis(static_cast<float>(-yaw_delta), glm::vec3{0.f, 1.f, 0.f}) * orientation *
+                          glm::angleAxis(static_cast<float>(-pitch_delta), glm::vec3{1.f, 0.f, 0.f}) *
+                          glm::angleAxis(static_cast<float>(-roll_delta), glm::vec3{0.f, 0.f, 1.f});
+
+            if (++updates_cnt % renormalize_period == 0)
+                orientation = glm::normalize(orientation);
+
+            view_dirty = true;
+        }
+
+        camera_scroll_callback<quat_camera> scroll_callback{*this};
+        camera_key_callback<quat_camera> key_callback{*this};
+        camera_cursor_pos_callback<quat_camera> cursor_pos_callback{*this};
+
+        // Integrates movement of held keys, expected to be called once per frame
+        void update(double const delta_time) {
+            key_callback.update(delta_time);
+        }
+
+        // Inverse of a rigid transform: transposed rotation followed by the negated translation
+        glm::mat4 const& get_view() const {
+            if (view_dirty) {
+                cached_view = glm::translate(glm::mat4_cast(glm::conjugate(orientation)), -position);
+                view_dirty = false;
+            }
+
+            return cached_view;
+        }
+    };
+
+    inline std::ostream &operator <<(std::ostream &o, quat_camera const &cam) {
+        auto const q{cam.get_orientation()};
+
+        return o << "pos = " << cam.get_pos_vec() <<
+                  "; direction = " << cam.get_direction_vec() <<
+                  "; up = " << cam.get_up_vec() <<
+                  "; orientation = (" << q.w << ", " << q.x << ", " << q.y << ", " << q.z << ')' <<
+                  "; fov = " << glm::degrees(cam.get_fov());
+    }
+}
+#endif
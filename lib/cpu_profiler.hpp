@@ -0,0 +1,200 @@
+#ifndef GL_CPU_PROFILER__
+#define GL_CPU_PROFILER__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Zones are recorded only when GL_CPU_PROFILER_ENABLED is defined (ENABLE_CPU_PROFILER
+// CMake option), otherwise the macros expand to nothing and cost nothing.
+// Zone names have to be string literals, only the pointer is stored.
+#define GL_CPU_PROFILE_CONCAT_IMPL(a, b) a##b
+#define GL_CPU_PROFILE_CONCAT(a, b) GL_CPU_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef GL_CPU_PROFILER_ENABLED
+#define CPU_PROFILE_SCOPE(name) \
+    gl_helpers::cpu_profiler::zone const GL_CPU_PROFILE_CONCAT(cpu_profile_zone_, __LINE__){name}
+#define CPU_PROFILE_THREAD_NAME(name) gl_helpers::cpu_profiler::set_thread_name(name)
+#else
+#define CPU_PROFILE_SCOPE(name) do {} while(0)
+#define CPU_PROFILE_THREAD_NAME(name) do {} while(0)
+#endif
+
+namespace gl_helpers {
+
+    // Every thread appends zones to its own fixed size buffer, so recording takes
+    // no locks and never allocates. The buffer is allocated by set_thread_name(),
+    // which a thread has to call before its first zone, zones of threads without
+    // a buffer are dropped. A full buffer drops further zones instead of growing.
+    class cpu_profiler {
+    public:
+        static constexpr std::size_t thread_capacity{1 << 16};
+
+        using steady_clock = std::chrono::steady_clock;
+
+        class zone {
+        private:
+            char const *name;
+            steady_clock::time_point begin;
+
+        public:
+            explicit zone(char const *const name) noexcept : name{name}, begin{steady_clock::now()} { }
+
+            zone(zone const&) = delete;
+            zone& operator=(zone const&) = delete;
+
+            ~zone() {
+                record(name, begin, steady_clock::now());
+            }
+        };
+
+    private:
+        struct event {
+            char const *name;
+            steady_clock::time_point begin;
+            steady_clock::time_point end;
+        };
+
+        // Outlives its thread, so zones of finished threads can still be exported
+        struct thread_buffer {
+            std::vector<event> events;
+            std::atomic<std::size_t> events_cnt{0};
+            std::atomic<std::size_t> dropped_cnt{0};
+            std::string name;
+            std::size_t id;
+
+            explicit thread_buffer(std::size_t const id) : events(thread_capacity), id{id} { }
+        };
+
+        struct registry {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<thread_buffer>> buffers;
+            std::atomic<std::size_t> unregistered_dropped_cnt{0};
+        };
+
+        static registry& get_registry() {
+            static registry reg;
+            return reg;
+        }
+
+        // Null until set_thread_name() registers the calling thread
+        static thread_buffer*& get_thread_buffer() noexcept {
+            thread_local thread_buffer *buffer{nullptr};
+            return buffer;
+        }
+
+        static void record(char const *const name, steady_clock::time_point const begin,
+                           steady_clock::time_point const end) noexcept {
+            auto *const thread_buffer{get_thread_buffer()};
+            if (!thread_buffer) {
+                get_registry().unregistered_dropped_cnt.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            auto& buffer{*thread_buffer};
+            auto const idx{buffer.events_cnt.load(std::memory_order_relaxed)};
+
+            if (idx == thread_capacity) {
+                buffer.dropped_cnt.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            buffer.events[idx] = {name, begin, end};
+            buffer.events_cnt.store(idx + 1, std::memory_order_release);
+        }
+
+        static void write_escaped(std::ostream& os, std::string const& str) {
+            for (auto const c : str) {
+                if (c == '"' || c == '\\')
+                    os << '\\';
+                os << c;
+            }
+        }
+
+    public:
+        // Registers the calling thread on the first call, allocating its buffer.
+        // The name is shown as the track name in trace viewers.
+        static void set_thread_name(std::string name) noexcept(false) {
+            auto& reg{get_registry()};
+            std::lock_guard<std::mutex> const lock{reg.mutex};
+
+            auto*& buffer{get_thread_buffer()};
+            if (!buffer) {
+                // The registry keeps the buffer alive after the thread exits
+                reg.buffers.push_back(std::make_shared<thread_buffer>(reg.buffers.size() + 1));
+                buffer = reg.buffers.back().get();
+            }
+            buffer->name = std::move(name);
+        }
+
+        [[nodiscard]]
+        static std::size_t get_dropped_cnt() {
+            auto& reg{get_registry()};
+            std::lock_guard<std::mutex> const lock{reg.mutex};
+
+            std::size_t dropped{reg.unregistered_dropped_cnt.load(std::memory_order_relaxed)};
+            for (auto const& buffer : reg.buffers)
+                dropped += buffer->dropped_cnt.load(std::memory_order_relaxed);
+            return dropped;
+        }
+
+        // Chrome trace event format, loadable by chrome://tracing and Perfetto.
+        // Threads may keep recording meanwhile, zones completed after the call are not written.
+        template<typename T>
+        static void write_chrome_trace(T&& filename) noexcept(false) {
+            std::ofstream ofs{std::forward<T>(filename)};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+            ofs << std::fixed << std::setprecision(3);
+
+            auto& reg{get_registry()};
+            std::lock_guard<std::mutex> const lock{reg.mutex};
+
+            // Timestamps are written relative to the earliest recorded zone. Zones are
+            // stored in order of completion, so an outer one comes after its children.
+            auto start{steady_clock::time_point::max()};
+            for (auto const& buffer : reg.buffers) {
+                auto const events_cnt{buffer->events_cnt.load(std::memory_order_acquire)};
+                for (std::size_t i{0}; i < events_cnt; ++i)
+                    start = std::min(start, buffer->events[i].begin);
+            }
+
+            auto to_us = [start](steady_clock::time_point const time) {
+                return std::chrono::duration<double, std::micro>{time - start}.count();
+            };
+
+            char const *separator{"\n"};
+            ofs << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+            for (auto const& buffer : reg.buffers) {
+                if (!buffer->name.empty()) {
+                    ofs << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " <<
+                           buffer->id << ", \"args\": {\"name\": \"";
+                    write_escaped(ofs, buffer->name);
+                    ofs << "\"}}";
+                    separator = ",\n";
+                }
+
+                auto const events_cnt{buffer->events_cnt.load(std::memory_order_acquire)};
+                for (std::size_t i{0}; i < events_cnt; ++i) {
+                    auto const& e{buffer->events[i]};
+
+                    ofs << separator << "{\"name\": \"";
+                    write_escaped(ofs, e.name);
+                    ofs << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id <<
+                           ", \"ts\": " << to_us(e.begin) << ", \"dur\": " << to_us(e.end) - to_us(e.begin) << '}';
+                    separator = ",\n";
+                }
+            }
+
+            ofs << "\n]}\n";
+        }
+    };
+}
+#endif
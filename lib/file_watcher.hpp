@@ -0,0 +1,169 @@
+#ifndef GL_FILE_WATCHER__
+#define GL_FILE_WATCHER__
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace gl_helpers {
+
+    // Calls back from a background thread with the path of every watched file
+    // which has been written. Editors often save through a temporary file and
+    // a rename, so on Linux the parent directories are watched with inotify and
+    // events are matched by name; elsewhere modification times are polled.
+    // Events are collected until the files stay untouched for settle_time, so
+    // one save results in one call however many writes it takes.
+    class file_watcher {
+    public:
+        using callback = std::function<void(std::string const& path)>;
+
+        static constexpr std::chrono::milliseconds settle_time{50};
+
+    private:
+        callback on_change;
+
+        std::mutex mutex;
+        std::atomic<bool> stopping{false};
+
+#ifdef __linux__
+        int inotify_fd{-1};
+        std::unordered_set<std::string> files;
+        std::unordered_map<int, std::filesystem::path> directories;
+
+        // An empty directory stands for the current one, so reported paths stay relative
+        void add_directory(std::filesystem::path const& directory) {
+            for (auto const& [wd, path] : directories) {
+                if (path == directory)
+                    return;
+            }
+
+            auto const wd{inotify_add_watch(inotify_fd, directory.empty() ? "." : directory.c_str(),
+                                            IN_CLOSE_WRITE | IN_MOVED_TO)};
+            if (wd < 0)
+                throw std::runtime_error("Failed to watch " + directory.string() + ": " + std::strerror(errno));
+
+            directories.emplace(wd, directory);
+        }
+
+        void watch_loop() {
+            std::unordered_set<std::string> changed;
+            alignas(inotify_event) char events[4096];
+
+            while (!stopping) {
+                pollfd pfd{inotify_fd, POLLIN, 0};
+                auto const ready{poll(&pfd, 1, static_cast<int>(settle_time.count()))};
+
+                if (ready == 0 && !changed.empty()) {
+                    for (auto const& path : changed)
+                        on_change(path);
+                    changed.clear();
+                }
+                if (ready <= 0)
+                    continue;
+
+                auto const len{read(inotify_fd, events, sizeof(events))};
+
+                std::lock_guard<std::mutex> const lock{mutex};
+                for (ssize_t offset{0}; offset < len; ) {
+                    auto const& event{*reinterpret_cast<inotify_event const*>(events + offset)};
+                    offset += sizeof(inotify_event) + event.len;
+
+                    auto const it{directories.find(event.wd)};
+                    if (it == std::end(directories) || !event.len)
+                        continue;
+
+                    auto path{(it->second / event.name).string()};
+                    if (files.count(path))
+                        changed.insert(std::move(path));
+                }
+            }
+        }
+#else
+        std::unordered_map<std::string, std::filesystem::file_time_type> write_times;
+
+        static std::filesystem::file_time_type get_write_time(std::string const& path) {
+            std::error_code ec;
+            return std::filesystem::last_write_time(path, ec);
+        }
+
+        void watch_loop() {
+            std::unordered_set<std::string> changed;
+
+            while (!stopping) {
+                std::this_thread::sleep_for(settle_time);
+
+                bool touched{false};
+                {
+                    std::lock_guard<std::mutex> const lock{mutex};
+                    for (auto& [path, write_time] : write_times) {
+                        if (auto const t{get_write_time(path)}; t != write_time) {
+                            write_time = t;
+                            changed.insert(path);
+                            touched = true;
+                        }
+                    }
+                }
+
+                if (!touched && !changed.empty()) {
+                    for (auto const& path : changed)
+                        on_change(path);
+                    changed.clear();
+                }
+            }
+        }
+#endif
+
+        std::thread watcher;
+
+    public:
+        explicit file_watcher(callback on_change) noexcept(false) : on_change{std::move(on_change)} {
+#ifdef __linux__
+            inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotify_fd < 0)
+                throw std::runtime_error(std::string{"Failed to initialize inotify: "} + std::strerror(errno));
+#endif
+            watcher = std::thread{[this] { watch_loop(); }};
+        }
+
+        file_watcher(file_watcher const&) = delete;
+        file_watcher& operator=(file_watcher const&) = delete;
+
+        ~file_watcher() {
+            stopping = true;
+            watcher.join();
+#ifdef __linux__
+            close(inotify_fd);
+#endif
+        }
+
+        // Paths are reported back lexically normalized, "./a/../b.vert" as "b.vert"
+        void watch(std::string const& path) noexcept(false) {
+            auto const normalized{std::filesystem::path{path}.lexically_normal()};
+
+            std::lock_guard<std::mutex> const lock{mutex};
+#ifdef __linux__
+            add_directory(normalized.parent_path());
+            files.insert(normalized.string());
+#else
+            write_times.emplace(normalized.string(), get_write_time(normalized.string()));
+#endif
+        }
+    };
+}
+#endif
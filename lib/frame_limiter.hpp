@@ -0,0 +1,67 @@
+#ifndef GL_FRAME_LIMITER__
+#define GL_FRAME_LIMITER__
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace gl_helpers {
+
+    // Caps the frame rate without relying on vsync. The OS sleep is too coarse
+    // to hit a deadline precisely, so the thread sleeps until spin_threshold
+    // before the deadline and busy-waits the rest.
+    class frame_limiter {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr std::chrono::microseconds default_spin_threshold{2000};
+
+    private:
+        clock::duration period;
+        clock::duration spin_threshold;
+        clock::time_point deadline;
+
+        // Validates fps before converting, a non-finite or out of range
+        // duration_cast is undefined behaviour
+        static inline clock::duration calc_period(double const fps) noexcept(false) {
+            if (!(fps > 0.))
+                throw std::runtime_error("Frame rate limit has to be positive");
+
+            std::chrono::duration<double> const period{1. / fps};
+            if (!(period < std::chrono::duration<double>{clock::duration::max()}))
+                throw std::runtime_error("Frame rate limit is too low");
+
+            return std::chrono::duration_cast<clock::duration>(period);
+        }
+
+    public:
+        explicit frame_limiter(double const fps, clock::duration const spin_threshold = default_spin_threshold)
+                : period{calc_period(fps)},
+                  spin_threshold{spin_threshold},
+                  deadline{clock::now() + period}
+        { }
+
+        // Blocks until the end of the current frame period and starts the next one
+        void wait() noexcept {
+            if (auto const now{clock::now()}; now < deadline) {
+                if (deadline - now > spin_threshold)
+                    std::this_thread::sleep_for(deadline - now - spin_threshold);
+
+                while (clock::now() < deadline)
+                    std::this_thread::yield();
+
+                deadline += period;
+            } else {
+                // Missed the deadline: start over instead of rushing through
+                // several frames to catch up with the schedule
+                deadline = now + period;
+            }
+        }
+
+        [[nodiscard]]
+        inline clock::duration get_period() const noexcept {
+            return period;
+        }
+    };
+}
+#endif
@@ -0,0 +1,39 @@
+#ifndef GL_FRUSTUM__
+#define GL_FRUSTUM__
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+namespace gl_helpers {
+
+    // Planes are stored as (normal, distance) with normals pointing inside the frustum,
+    // so a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them.
+    struct frustum {
+        enum plane_idx { left, right, bottom, top, near, far, planes_cnt };
+
+        std::array<glm::vec4, planes_cnt> planes;
+    };
+
+    // Gribb-Hartmann plane extraction from a (projection * view) matrix
+    inline frustum extract_frustum(glm::mat4 const& view_projection) noexcept {
+        auto row = [&view_projection](int const i) {
+            return glm::vec4{view_projection[0][i], view_projection[1][i],
+                             view_projection[2][i], view_projection[3][i]};
+        };
+
+        auto normalize_plane = [](glm::vec4 const& plane) {
+            return plane / glm::length(glm::vec3{plane.x, plane.y, plane.z});
+        };
+
+        auto const r0{row(0)};
+        auto const r1{row(1)};
+        auto const r2{row(2)};
+        auto const r3{row(3)};
+
+        return {{normalize_plane(r3 + r0), normalize_plane(r3 - r0),
+                 normalize_plane(r3 + r1), normalize_plane(r3 - r1),
+                 normalize_plane(r3 + r2), normalize_plane(r3 - r2)}};
+    }
+}
+#endif
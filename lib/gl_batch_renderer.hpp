@@ -0,0 +1,125 @@
+#ifndef GL_BATCH_RENDERER__
+#define GL_BATCH_RENDERER__
+
+#include "gl_wrappers.hpp"
+#include "gl_ring_buffer.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Layout is fixed by the GL spec, see DrawElementsIndirectCommand
+    struct draw_elements_indirect_command {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint  base_vertex;
+        GLuint base_instance;
+    };
+
+    static_assert(sizeof(draw_elements_indirect_command) == 5 * sizeof(GLuint));
+
+    // Accumulates draws of the currently bound VAO and submits them with a single
+    // glMultiDrawElementsIndirect call. Per-draw data is exposed to shaders as
+    // a std430 array in the shader storage block bound to per_draw_binding and
+    // is meant to be indexed with gl_DrawIDARB.
+    template<typename PER_DRAW_T>
+    class batch_renderer {
+    private:
+        static_assert(std::is_trivially_copyable_v<PER_DRAW_T>, "Per-draw data must be trivially copyable");
+
+        std::size_t max_draws;
+        GLuint per_draw_binding;
+        std::size_t storage_alignment;
+        ring_buffer storage;
+
+        std::vector<draw_elements_indirect_command> commands;
+        std::vector<PER_DRAW_T> per_draw;
+
+        static inline std::size_t check_support() noexcept(false) {
+            if (!GLEW_ARB_shader_draw_parameters)
+                throw std::runtime_error("batch_renderer requires GL_ARB_shader_draw_parameters");
+
+            return static_cast<std::size_t>(ring_buffer::get_storage_alignment());
+        }
+
+    public:
+        explicit batch_renderer(std::size_t const max_draws, GLuint const per_draw_binding = 0)
+                : max_draws{max_draws}, per_draw_binding{per_draw_binding},
+                  storage_alignment{check_support()},
+                  // Regions start aligned for storage buffers, so the per-draw block needs no
+                  // padding and only the commands after it may have to be aligned
+                  storage{max_draws * (sizeof(PER_DRAW_T) + sizeof(draw_elements_indirect_command)) +
+                          alignof(draw_elements_indirect_command)}
+        {
+            commands.reserve(max_draws);
+            per_draw.reserve(max_draws);
+        }
+
+        batch_renderer(batch_renderer const&) = delete;
+        batch_renderer& operator=(batch_renderer const&) = delete;
+        batch_renderer(batch_renderer&&) noexcept = default;
+        batch_renderer& operator=(batch_renderer&&) noexcept = default;
+
+        [[nodiscard]]
+        inline auto size() const noexcept {
+            return commands.size();
+        }
+
+        void add(draw_elements_indirect_command cmd, PER_DRAW_T const& data) noexcept(false) {
+            if (commands.size() == max_draws)
+                throw std::runtime_error("batch_renderer is full: "s + std::to_string(max_draws) + " draws"s);
+
+            // base_instance is set as well, so instanced attributes and shaders
+            // without gl_DrawIDARB are still able to find their per-draw data
+            cmd.base_instance = static_cast<GLuint>(commands.size());
+            commands.push_back(cmd);
+            per_draw.push_back(data);
+        }
+
+        void add(GLuint const count, GLuint const first_index, GLint const base_vertex, PER_DRAW_T const& data) {
+            add({count, 1, first_index, base_vertex, 0}, data);
+        }
+
+        void submit(GLenum const mode = GL_TRIANGLES, GLenum const type = GL_UNSIGNED_INT) noexcept(false) {
+            if (commands.empty())
+                return;
+
+            storage.begin_frame();
+
+            auto const per_draw_size{sizeof(PER_DRAW_T) * per_draw.size()};
+            auto const per_draw_offset{storage.push(per_draw.data(), per_draw.size(), storage_alignment)};
+            auto const commands_offset{storage.push(commands.data(), commands.size(),
+                                                    alignof(draw_elements_indirect_command))};
+
+            storage.bind_range(GL_SHADER_STORAGE_BUFFER, per_draw_binding, per_draw_offset, per_draw_size);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, storage.get_id());
+            glMultiDrawElementsIndirect(mode, type, reinterpret_cast<void const *>(commands_offset),
+                                        static_cast<GLsizei>(commands.size()), 0);
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to submit batch");
+
+            std::uint64_t triangles{0};
+            for (auto const& cmd : commands)
+                triangles += frame_stats::get_triangles_cnt(mode, cmd.count) * cmd.instance_count;
+            frame_stats::count_draws(commands.size(), triangles);
+            frame_stats::count_state_changes();
+
+            storage.end_frame();
+
+            commands.clear();
+            per_draw.clear();
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
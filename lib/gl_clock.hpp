@@ -0,0 +1,151 @@
+#ifndef GL_CLOCK__
+#define GL_CLOCK__
+
+#include "gl_wrappers.hpp"
+
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gl_wrappers {
+
+    // Source of animation time. It is sampled once per frame by tick(), so all
+    // objects of a frame are animated with the same time, and deterministic
+    // clocks make runs reproducible frame for frame.
+    class clock {
+    private:
+        double time{0.};
+        double delta{0.};
+        bool started{false};
+
+    protected:
+        virtual double sample() = 0;
+
+    public:
+        clock() = default;
+        clock(clock const&) = delete;
+        clock& operator=(clock const&) = delete;
+        virtual ~clock() = default;
+
+        // Starts a new frame and returns its time
+        double tick() noexcept(false) {
+            auto const new_time{sample()};
+
+            delta = started ? new_time - time : 0.;
+            time = new_time;
+            started = true;
+            return time;
+        }
+
+        // Time of the current frame, 0 before the first tick
+        [[nodiscard]]
+        inline double get_time() const noexcept {
+            return time;
+        }
+
+        // Time passed since the previous frame, 0 on the first one
+        [[nodiscard]]
+        inline double get_delta() const noexcept {
+            return delta;
+        }
+    };
+
+    class real_clock final : public clock {
+    protected:
+        double sample() override {
+            return glfw::get_time();
+        }
+    };
+
+    class fixed_step_clock final : public clock {
+    private:
+        double step;
+        double start;
+        std::size_t frame{0};
+
+    public:
+        explicit fixed_step_clock(double const step, double const start = 0.) : step{step}, start{start} {
+            if (!(step > 0.))
+                throw std::runtime_error("Clock step has to be positive");
+        }
+
+    protected:
+        double sample() override {
+            return start + step * static_cast<double>(frame++);
+        }
+    };
+
+    // Plays back frame times captured by recording_clock
+    class replay_clock final : public clock {
+    private:
+        std::vector<double> times;
+        std::size_t frame{0};
+
+    public:
+        explicit replay_clock(std::vector<double> times) : times{std::move(times)} {
+            if (this->times.empty())
+                throw std::runtime_error("Nothing to replay");
+        }
+
+        // Text file with one time per line, as written by recording_clock::save()
+        template<typename T>
+        static std::unique_ptr<replay_clock> from_file(T&& filename) noexcept(false) {
+            std::ifstream ifs{std::forward<T>(filename)};
+
+            if (!ifs)
+                throw std::runtime_error("Cannot open clock recording "s + filename);
+
+            std::vector<double> times;
+            for (double time; ifs >> time;)
+                times.push_back(time);
+
+            if (!ifs.eof())
+                throw std::runtime_error("Malformed clock recording "s + filename);
+
+            return std::make_unique<replay_clock>(std::move(times));
+        }
+
+        [[nodiscard]]
+        inline bool is_exhausted() const noexcept {
+            return frame >= times.size();
+        }
+
+    protected:
+        double sample() override {
+            if (is_exhausted())
+                throw std::runtime_error("Clock replay has run out of recorded frames");
+
+            return times[frame++];
+        }
+    };
+
+    // Passes through the time of another clock remembering every frame
+    class recording_clock final : public clock {
+    private:
+        std::unique_ptr<clock> source;
+        std::vector<double> times;
+
+    public:
+        explicit recording_clock(std::unique_ptr<clock> source) : source{std::move(source)} { }
+
+        template<typename T>
+        void save(T&& filename) const noexcept(false) {
+            std::ofstream ofs{std::forward<T>(filename)};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+            ofs.precision(std::numeric_limits<double>::max_digits10);
+            for (auto const time : times)
+                ofs << time << '\n';
+        }
+
+    protected:
+        double sample() override {
+            times.push_back(source->tick());
+            return times.back();
+        }
+    };
+}
+#endif
@@ -0,0 +1,349 @@
+#ifndef GL_GPU_CULLING__
+#define GL_GPU_CULLING__
+
+#include "gl_wrappers.hpp"
+#include "gl_batch_renderer.hpp"
+#include "gl_hiz.hpp"
+#include "frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Matches the std430 layout of cull_instance in the culling shader
+    struct cull_instance {
+        glm::vec4 sphere; // xyz - center in world space, w - radius
+        draw_elements_indirect_command command;
+        GLuint padding[3];
+    };
+
+    static_assert(sizeof(cull_instance) == 48);
+
+    struct culling_stats {
+        GLuint instances;
+        GLuint frustum_culled;
+        GLuint occlusion_culled;
+        GLuint drawn;
+    };
+
+    // Tests bounding spheres of all instances against the view frustum in a compute
+    // shader and compacts draw commands of the visible ones into an indirect buffer.
+    // Compacted commands keep their base_instance, so vertex shaders are supposed to
+    // look per-draw data up with gl_BaseInstanceARB rather than gl_DrawIDARB.
+    //
+    // With a built hiz_pyramid passed to cull() spheres that survived the frustum test
+    // are also tested against the previous frame depth, see is_occluded() in the shader.
+    class gpu_culler {
+    public:
+        static constexpr GLuint instances_binding{5};
+        static constexpr GLuint commands_binding{6};
+        static constexpr GLuint count_binding{7};
+        static constexpr GLuint stats_binding{8};
+        static constexpr GLuint hiz_texture_unit{7};
+        // Stats are read back with this delay so reading never waits for the GPU
+        static constexpr std::size_t stats_latency{3};
+        static constexpr GLuint group_size{64};
+
+    private:
+        static constexpr char const *cull_shader_source{R"(
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct draw_command {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int  base_vertex;
+    uint base_instance;
+};
+
+struct cull_instance {
+    vec4 sphere;
+    draw_command command;
+    uint padding[3];
+};
+
+layout (std430, binding = 5) readonly buffer instances_block {
+    cull_instance instances[];
+};
+
+layout (std430, binding = 6) writeonly buffer commands_block {
+    draw_command commands[];
+};
+
+layout (std430, binding = 7) buffer count_block {
+    uint draw_count;
+};
+
+layout (std430, binding = 8) buffer stats_block {
+    uint frustum_culled;
+    uint occlusion_culled;
+};
+
+uniform vec4 frustum_planes[6];
+uniform uint instances_cnt;
+
+uniform bool use_hiz;
+// Transform the depth in hiz was rendered with, usually the one of the previous frame
+uniform mat4 hiz_view_projection;
+uniform sampler2D hiz;
+uniform vec2 hiz_uv_scale;
+
+bool is_occluded(vec4 sphere)
+{
+    vec2 ndc_min = vec2(1.0);
+    vec2 ndc_max = vec2(-1.0);
+    float depth_min = 1.0;
+
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                                   (i & 2) != 0 ? 1.0 : -1.0,
+                                                   (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = hiz_view_projection * vec4(corner, 1.0);
+
+        // Crosses the near plane, projected bounds are meaningless
+        if (clip.w <= 0.0)
+            return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        ndc_min = min(ndc_min, ndc.xy);
+        ndc_max = max(ndc_max, ndc.xy);
+        depth_min = min(depth_min, ndc.z * 0.5 + 0.5);
+    }
+
+    // Partly outside the view the depth was rendered with, nothing is known there
+    if (any(lessThan(ndc_min, vec2(-1.0))) || any(greaterThan(ndc_max, vec2(1.0))))
+        return false;
+
+    vec2 uv_min = (ndc_min * 0.5 + 0.5) * hiz_uv_scale;
+    vec2 uv_max = (ndc_max * 0.5 + 0.5) * hiz_uv_scale;
+
+    // Level at which the bounds cover at most 2x2 texels, each of them covering
+    // the same power of two square of depth texels
+    vec2 size = (uv_max - uv_min) * vec2(textureSize(hiz, 0));
+    float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+
+    float occluder_depth = max(max(textureLod(hiz, uv_min, level).r,
+                                   textureLod(hiz, vec2(uv_max.x, uv_min.y), level).r),
+                               max(textureLod(hiz, vec2(uv_min.x, uv_max.y), level).r,
+                                   textureLod(hiz, uv_max, level).r));
+
+    return depth_min > occluder_depth;
+}
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+
+    if (idx >= instances_cnt)
+        return;
+
+    vec4 sphere = instances[idx].sphere;
+
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustum_planes[i].xyz, sphere.xyz) + frustum_planes[i].w < -sphere.w) {
+            atomicAdd(frustum_culled, 1u);
+            return;
+        }
+    }
+
+    if (use_hiz && is_occluded(sphere)) {
+        atomicAdd(occlusion_culled, 1u);
+        return;
+    }
+
+    commands[atomicAdd(draw_count, 1u)] = instances[idx].command;
+}
+)"};
+
+        shader_program program;
+        GLuint const frustum_planes_id;
+        GLuint const instances_cnt_id;
+        GLuint const use_hiz_id;
+        GLuint const hiz_view_projection_id;
+        GLuint const hiz_uv_scale_id;
+
+        enum { instances_buf, commands_buf, count_buf, buffers_cnt };
+        std::array<buffer_object, buffers_cnt> buffers{buffer_object{"culling instances"},
+                                                       buffer_object{"culling commands"},
+                                                       buffer_object{"culling count"}};
+        GLuint instances_cnt{0};
+        bool const has_indirect_count;
+
+        struct stats_slot {
+            buffer_object buffer{"culling stats"};
+            GLsync fence{nullptr};
+            GLuint instances{0};
+        };
+        std::array<stats_slot, stats_latency> stats_slots{};
+        std::size_t stats_idx{0};
+        culling_stats last_stats{};
+
+        inline void destroy() noexcept(true) {
+            for (auto &slot : stats_slots) {
+                if (slot.fence)
+                    glDeleteSync(slot.fence);
+            }
+        }
+
+        // Picks up results of the oldest slot if the GPU is done with them
+        void collect_stats(stats_slot &slot) noexcept {
+            if (!slot.fence || glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                return;
+
+            glDeleteSync(std::exchange(slot.fence, nullptr));
+
+            GLuint counters[2];
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer.get_id());
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), counters);
+
+            last_stats = {slot.instances, counters[0], counters[1], slot.instances - counters[0] - counters[1]};
+        }
+
+        static inline void clear_buffer(GLuint const id) noexcept {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        }
+
+    public:
+        gpu_culler()
+                : program{compute_shader{std::string{cull_shader_source}}},
+                  frustum_planes_id{program.get_uniform_id("frustum_planes")},
+                  instances_cnt_id{program.get_uniform_id("instances_cnt")},
+                  use_hiz_id{program.get_uniform_id("use_hiz")},
+                  hiz_view_projection_id{program.get_uniform_id("hiz_view_projection")},
+                  hiz_uv_scale_id{program.get_uniform_id("hiz_uv_scale")},
+                  has_indirect_count{GLEW_ARB_indirect_parameters == GL_TRUE}
+        {
+            if (!GLEW_ARB_shader_draw_parameters)
+                throw std::runtime_error("gpu_culler requires GL_ARB_shader_draw_parameters");
+
+            buffers[count_buf].set_data(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+
+            for (auto &slot : stats_slots)
+                slot.buffer.set_data(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+
+            program.apply();
+            program.set_uniform<GLint>(program.get_uniform_id("hiz"), GLint{hiz_texture_unit});
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to create gpu_culler buffers");
+        }
+
+        gpu_culler(gpu_culler const&) = delete;
+        gpu_culler& operator=(gpu_culler const&) = delete;
+
+        ~gpu_culler() {
+            destroy();
+        }
+
+        // Instances live on GPU, so per-frame CPU cost does not depend on their amount
+        void set_instances(std::vector<cull_instance> const& instances) noexcept(false) {
+            instances_cnt = static_cast<GLuint>(instances.size());
+
+            buffers[instances_buf].set_data(GL_SHADER_STORAGE_BUFFER, sizeof(cull_instance) * instances.size(),
+                                            instances.data(), GL_STATIC_DRAW);
+            buffers[commands_buf].set_data(GL_SHADER_STORAGE_BUFFER,
+                                           sizeof(draw_elements_indirect_command) * instances.size(),
+                                           nullptr, GL_DYNAMIC_DRAW);
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to upload culling instances");
+        }
+
+        [[nodiscard]]
+        inline auto get_instances_cnt() const noexcept {
+            return instances_cnt;
+        }
+
+        // Statistics of a frame stats_latency frames ago, or older if the GPU lags behind
+        [[nodiscard]]
+        inline culling_stats get_stats() const noexcept {
+            return last_stats;
+        }
+
+        // Spheres are tested against the pyramid in the space it was built in, see
+        // hiz_pyramid::get_view_projection(), so a fast camera turn does not compare
+        // them with depth of unrelated pixels. Objects uncovered since that frame
+        // may still appear one frame late, the usual price of reusing the previous depth.
+        void cull(glm::mat4 const& view_projection, hiz_pyramid const* hiz = nullptr) noexcept(false) {
+            if (!instances_cnt)
+                return;
+
+            auto const planes{gl_helpers::extract_frustum(view_projection).planes};
+            bool const use_hiz{hiz && hiz->is_built()};
+
+            auto &slot{stats_slots[stats_idx]};
+            collect_stats(slot);
+            if (slot.fence)
+                glDeleteSync(std::exchange(slot.fence, nullptr));
+            slot.instances = instances_cnt;
+
+            clear_buffer(slot.buffer.get_id());
+            clear_buffer(buffers[count_buf].get_id());
+            // Without an indirect count the whole buffer is drawn, so the tail
+            // behind the visible commands has to contain empty draws
+            if (!has_indirect_count)
+                clear_buffer(buffers[commands_buf].get_id());
+
+            program.apply();
+            program.set_vector_uniform<GLfloat, 4>(frustum_planes_id, planes.size(), &planes[0].x);
+            program.set_uniform<GLuint>(instances_cnt_id, GLuint{instances_cnt});
+            program.set_uniform<GLint>(use_hiz_id, GLint{use_hiz});
+
+            if (use_hiz) {
+                program.set_matrix_uniform<GLfloat, 4>(hiz_view_projection_id, 1, &hiz->get_view_projection()[0][0]);
+                auto const [scale_x, scale_y]{hiz->get_uv_scale()};
+                GLfloat const uv_scale[]{scale_x, scale_y};
+                program.set_vector_uniform<GLfloat, 2>(hiz_uv_scale_id, 1, uv_scale);
+                bind_texture(hiz_texture_unit, GL_TEXTURE_2D, hiz->get_id());
+                glActiveTexture(GL_TEXTURE0);
+            }
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, instances_binding, buffers[instances_buf].get_id());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, commands_binding, buffers[commands_buf].get_id());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, count_binding, buffers[count_buf].get_id());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, stats_binding, slot.buffer.get_id());
+            frame_stats::count_state_changes(4);
+
+            glDispatchCompute((instances_cnt + group_size - 1) / group_size, 1, 1);
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to dispatch culling");
+
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            stats_idx = (stats_idx + 1) % stats_latency;
+        }
+
+        // Draws visible instances with the currently bound program and VAO
+        void draw(GLenum const mode = GL_TRIANGLES, GLenum const type = GL_UNSIGNED_INT) noexcept(false) {
+            if (!instances_cnt)
+                return;
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[commands_buf].get_id());
+
+            if (has_indirect_count) {
+                glBindBuffer(GL_PARAMETER_BUFFER_ARB, buffers[count_buf].get_id());
+                glMultiDrawElementsIndirectCountARB(mode, type, nullptr, 0, instances_cnt, 0);
+            } else {
+                glMultiDrawElementsIndirect(mode, type, nullptr, instances_cnt, 0);
+            }
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to draw culled instances");
+
+            // Which commands survive is decided on the GPU, so triangles are not known here
+            frame_stats::count_draws(1);
+            frame_stats::count_state_changes();
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
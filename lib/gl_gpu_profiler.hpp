@@ -0,0 +1,235 @@
+#ifndef GL_GPU_PROFILER__
+#define GL_GPU_PROFILER__
+
+#include "gl_wrappers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Measures GPU time of named scopes. Scope bounds are GL_TIMESTAMP queries,
+    // which unlike GL_TIME_ELAPSED may nest. Every frame has its own set of queries,
+    // and results are read only when the set comes round again frames_in_flight
+    // frames later; a frame whose results are still not available by then is
+    // dropped rather than waited for, so the profiler never stalls the pipeline.
+    class gpu_profiler {
+    public:
+        static constexpr std::size_t default_frames_in_flight{4};
+        static constexpr std::size_t default_max_scopes{64};
+
+        // Statistics are kept over this many latest frames of every scope
+        static constexpr std::size_t history_size{128};
+
+        struct scope_stats {
+            double min_ms{0.};
+            double avg_ms{0.};
+            double p99_ms{0.};
+            std::size_t samples{0};
+        };
+
+        // Times the GPU work issued during its lifetime and labels it for debuggers
+        class scope {
+        private:
+            gpu_profiler& profiler;
+
+        public:
+            scope(gpu_profiler& profiler, char const *const name) : profiler{profiler} {
+                profiler.begin_scope(name);
+            }
+
+            scope(scope const&) = delete;
+            scope& operator=(scope const&) = delete;
+
+            ~scope() {
+                profiler.end_scope();
+            }
+        };
+
+    private:
+        static constexpr std::size_t untimed_scope{std::numeric_limits<std::size_t>::max()};
+
+        struct scope_record {
+            std::size_t history_idx;
+            GLuint begin_query;
+            GLuint end_query;
+        };
+
+        struct frame_queries {
+            std::vector<query_object> queries;
+            std::size_t used_cnt{0};
+            std::vector<scope_record> records;
+        };
+
+        struct scope_history {
+            std::string name;
+            std::array<double, history_size> samples{};
+            std::size_t samples_cnt{0};
+            std::size_t next_sample{0};
+        };
+
+        std::vector<frame_queries> frames;
+        std::size_t current_frame{0};
+
+        // Records of the scopes currently open, innermost last
+        std::vector<std::size_t> open_scopes;
+
+        std::vector<scope_history> histories;
+        std::unordered_map<std::string, std::size_t> history_indices;
+        std::size_t dropped_frames_cnt{0};
+
+        std::size_t get_history_idx(char const *const name) {
+            if (auto const it{history_indices.find(name)}; it != std::end(history_indices))
+                return it->second;
+
+            histories.push_back({name});
+            return history_indices.emplace(name, histories.size() - 1).first->second;
+        }
+
+        void begin_scope(char const *const name) {
+            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+            auto& frame{frames[current_frame]};
+
+            // Out of queries: the scope is still labeled, just not timed
+            if (frame.used_cnt + 2 > frame.queries.size()) {
+                open_scopes.push_back(untimed_scope);
+                return;
+            }
+
+            scope_record const record{get_history_idx(name), frame.queries[frame.used_cnt].get_id(),
+                                      frame.queries[frame.used_cnt + 1].get_id()};
+            frame.used_cnt += 2;
+
+            glQueryCounter(record.begin_query, GL_TIMESTAMP);
+            open_scopes.push_back(frame.records.size());
+            frame.records.push_back(record);
+        }
+
+        void end_scope() {
+            auto& frame{frames[current_frame]};
+            auto const record_idx{open_scopes.back()};
+            open_scopes.pop_back();
+
+            if (record_idx != untimed_scope)
+                glQueryCounter(frame.records[record_idx].end_query, GL_TIMESTAMP);
+
+            glPopDebugGroup();
+        }
+
+        void collect(frame_queries& frame) {
+            if (frame.records.empty())
+                return;
+
+            GLint available{GL_FALSE};
+            glGetQueryObjectiv(frame.records.back().end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available) {
+                for (auto const& record : frame.records) {
+                    GLuint64 begin_ns, end_ns;
+                    glGetQueryObjectui64v(record.begin_query, GL_QUERY_RESULT, &begin_ns);
+                    glGetQueryObjectui64v(record.end_query, GL_QUERY_RESULT, &end_ns);
+
+                    auto& history{histories[record.history_idx]};
+                    history.samples[history.next_sample] = static_cast<double>(end_ns - begin_ns) * 1e-6;
+                    history.next_sample = (history.next_sample + 1) % history_size;
+                    history.samples_cnt = std::min(history.samples_cnt + 1, history_size);
+                }
+            } else {
+                ++dropped_frames_cnt;
+            }
+
+            frame.records.clear();
+            frame.used_cnt = 0;
+        }
+
+    public:
+        explicit gpu_profiler(std::size_t const frames_in_flight = default_frames_in_flight,
+                              std::size_t const max_scopes = default_max_scopes) noexcept(false)
+                : frames(frames_in_flight)
+        {
+            if (!frames_in_flight || !max_scopes)
+                throw std::runtime_error("GPU profiler needs at least one frame and one scope");
+
+            for (auto& frame : frames) {
+                frame.queries.reserve(max_scopes * 2);
+                for (std::size_t i{0}; i < max_scopes * 2; ++i)
+                    frame.queries.emplace_back();
+                frame.records.reserve(max_scopes);
+            }
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to create GPU profiler queries");
+        }
+
+        gpu_profiler(gpu_profiler const&) = delete;
+        gpu_profiler& operator=(gpu_profiler const&) = delete;
+
+        // Has to be called once per frame outside of any scope. Collects the
+        // results of the frame issued frames_in_flight frames ago.
+        void begin_frame() noexcept(false) {
+            if (!open_scopes.empty())
+                throw std::runtime_error("GPU profiler frame cannot change inside a scope");
+
+            current_frame = (current_frame + 1) % frames.size();
+            collect(frames[current_frame]);
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to collect GPU profiler results");
+        }
+
+        [[nodiscard]]
+        scope_stats get_stats(std::string const& name) const {
+            auto const it{history_indices.find(name)};
+            if (it == std::end(history_indices))
+                return {};
+
+            auto const& history{histories[it->second]};
+            if (!history.samples_cnt)
+                return {};
+
+            std::vector<double> samples(std::begin(history.samples),
+                                        std::begin(history.samples) + history.samples_cnt);
+
+            auto const p99_it{std::begin(samples) + (samples.size() - 1) * 99 / 100};
+            std::nth_element(std::begin(samples), p99_it, std::end(samples));
+
+            double sum{0.};
+            for (auto const sample : samples)
+                sum += sample;
+
+            return {*std::min_element(std::begin(samples), std::end(samples)),
+                    sum / static_cast<double>(samples.size()), *p99_it, samples.size()};
+        }
+
+        // Stats of all scopes seen so far, in order of their first appearance
+        [[nodiscard]]
+        std::vector<std::pair<std::string, scope_stats>> get_all_stats() const {
+            std::vector<std::pair<std::string, scope_stats>> all_stats;
+            all_stats.reserve(histories.size());
+
+            for (auto const& history : histories)
+                all_stats.emplace_back(history.name, get_stats(history.name));
+
+            return all_stats;
+        }
+
+        [[nodiscard]]
+        inline std::size_t get_dropped_frames_cnt() const noexcept {
+            return dropped_frames_cnt;
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
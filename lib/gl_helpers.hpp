@@ -4,10 +4,14 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "3dparty/stb_image.h"
 
+#include "resource.hpp"
+
 #include <fstream>
 #include <iterator>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
@@ -25,18 +29,19 @@ namespace gl_helpers {
     }
 
 
-    //< TODO: not the best function. Should be deprecated.
-    template<typename T>
-    inline std::tuple<std::vector<std::uint8_t>, unsigned, unsigned, unsigned>
-    get_data_from_image(T&& filename) noexcept(false) {
+    using image_data = std::tuple<std::vector<std::uint8_t>, unsigned, unsigned, unsigned>;
+
+    // Takes the result of one of the stbi_load functions
+    template<typename F>
+    inline image_data decode_image(F&& load, std::string_view const name) noexcept(false) {
         int width, height, channels;
 
         auto free_buffer = [](std::uint8_t* ptr) { stbi_image_free(ptr); };
         std::unique_ptr<std::uint8_t, decltype(free_buffer)>
-                buffer(stbi_load(filename, &width, &height, &channels, 0), free_buffer);
+                buffer(load(&width, &height, &channels), free_buffer);
 
         if (!buffer) {
-            throw std::runtime_error("Failed to read image file"s + filename + ": " + stbi_failure_reason());
+            throw std::runtime_error("Failed to read image file "s + std::string{name} + ": " + stbi_failure_reason());
         }
 
         std::size_t buffer_sz(width * height * channels);
@@ -46,5 +51,25 @@ namespace gl_helpers {
                                                           static_cast<unsigned>(channels)};
     }
 
+    //< TODO: not the best function. Should be deprecated.
+    template<typename T>
+    inline image_data get_data_from_image(T&& filename) noexcept(false) {
+        return decode_image([&](int *width, int *height, int *channels) {
+            return stbi_load(filename, width, height, channels, 0);
+        }, filename);
+    }
+
+    // Decodes an image file already in memory, the name is only used in errors
+    inline image_data get_data_from_memory(byte_view const bytes, std::string_view const name) noexcept(false) {
+        return decode_image([&](int *width, int *height, int *channels) {
+            return stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), width, height, channels, 0);
+        }, name);
+    }
+
+    // Decodes straight from the embedded bytes, no file is opened
+    inline image_data get_data_from_resource(resource const& res) noexcept(false) {
+        return get_data_from_memory(res.get_bytes(), res.name);
+    }
+
 }
 #endif
@@ -0,0 +1,222 @@
+#ifndef GL_HIZ__
+#define GL_HIZ__
+
+#include "gl_wrappers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Hierarchical Z-buffer: every texel of level N holds the farthest depth of
+    // the texels it covers in level N - 1. Built from the depth buffer of the
+    // current read framebuffer, usually right after the frame has been drawn,
+    // so it describes occluders of the previous frame when culling the next one.
+    // Bounds tested against it have to be projected with get_view_projection(),
+    // the transform the depth was rendered with, not with the one of the new frame.
+    //
+    // Level 0 is padded to power of two sizes with the far plane depth, so every
+    // texel of level N covers exactly 2^N x 2^N depth texels and a footprint of
+    // at most 2^N texels always falls into 2x2 texels of level N. The depth
+    // buffer takes get_uv_scale() of the pyramid in each dimension.
+    class hiz_pyramid {
+    public:
+        static constexpr GLuint group_size{8};
+
+    private:
+        static constexpr char const *copy_shader_source{R"(
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D depth;
+layout (r32f, binding = 0) writeonly uniform image2D dst;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+
+    if (any(greaterThanEqual(coord, imageSize(dst))))
+        return;
+
+    // Padding never occludes anything
+    float value = all(lessThan(coord, textureSize(depth, 0))) ? texelFetch(depth, coord, 0).r : 1.0;
+    imageStore(dst, coord, vec4(value));
+}
+)"};
+
+        static constexpr char const *downsample_shader_source{R"(
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (r32f, binding = 0) readonly uniform image2D src;
+layout (r32f, binding = 1) writeonly uniform image2D dst;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+
+    if (any(greaterThanEqual(coord, imageSize(dst))))
+        return;
+
+    // Sizes are powers of two, a dimension already down to 1 texel stays so
+    ivec2 src_coord = coord * 2;
+    ivec2 last = imageSize(src) - 1;
+
+    float depth = max(max(imageLoad(src, src_coord).r,
+                          imageLoad(src, min(src_coord + ivec2(1, 0), last)).r),
+                      max(imageLoad(src, min(src_coord + ivec2(0, 1), last)).r,
+                          imageLoad(src, min(src_coord + ivec2(1, 1), last)).r));
+
+    imageStore(dst, coord, vec4(depth));
+}
+)"};
+
+        unsigned width;
+        unsigned height;
+        unsigned pyramid_width;
+        unsigned pyramid_height;
+        GLsizei levels_cnt;
+
+        shader_program copy_program;
+        shader_program downsample_program;
+
+        texture_object depth_texture{"hiz depth"};
+        texture_object pyramid_texture{"hiz pyramid"};
+        glm::mat4 view_projection{1.f};
+        bool built{false};
+
+        static inline GLsizei calc_levels(unsigned const width, unsigned const height) noexcept {
+            GLsizei levels{1};
+            for (auto size{std::max(width, height)}; size > 1; size /= 2)
+                ++levels;
+            return levels;
+        }
+
+        static inline unsigned round_up_pow2(unsigned const size) noexcept {
+            unsigned pow2{1};
+            while (pow2 < size)
+                pow2 *= 2;
+            return pow2;
+        }
+
+        static inline GLuint groups(unsigned const size) noexcept {
+            return (size + group_size - 1) / group_size;
+        }
+
+        static inline unsigned level_size(unsigned const size, GLsizei const level) noexcept {
+            return std::max(size >> level, 1u);
+        }
+
+    public:
+        // Sizes of the framebuffer in pixels, which differ from the window size on HiDPI displays
+        hiz_pyramid(unsigned const width, unsigned const height)
+                : width{width}, height{height},
+                  pyramid_width{round_up_pow2(width)}, pyramid_height{round_up_pow2(height)},
+                  levels_cnt{calc_levels(pyramid_width, pyramid_height)},
+                  copy_program{compute_shader{std::string{copy_shader_source}}},
+                  downsample_program{compute_shader{std::string{downsample_shader_source}}}
+        {
+            glBindTexture(GL_TEXTURE_2D, depth_texture.get_id());
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+            depth_texture.set_size(texture_object::estimate_size(width, height, 4, false));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            glBindTexture(GL_TEXTURE_2D, pyramid_texture.get_id());
+            glTexStorage2D(GL_TEXTURE_2D, levels_cnt, GL_R32F, pyramid_width, pyramid_height);
+            pyramid_texture.set_size(texture_object::estimate_size(pyramid_width, pyramid_height, 4, true));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to create HiZ textures");
+        }
+
+        hiz_pyramid(hiz_pyramid const&) = delete;
+        hiz_pyramid& operator=(hiz_pyramid const&) = delete;
+
+        [[nodiscard]]
+        inline auto get_id() const noexcept {
+            return pyramid_texture.get_id();
+        }
+
+        [[nodiscard]]
+        inline auto get_width() const noexcept {
+            return width;
+        }
+
+        [[nodiscard]]
+        inline auto get_height() const noexcept {
+            return height;
+        }
+
+        // Part of the pyramid covered by the depth buffer, scales screen UVs into pyramid UVs
+        [[nodiscard]]
+        inline std::pair<float, float> get_uv_scale() const noexcept {
+            return {static_cast<float>(width) / static_cast<float>(pyramid_width),
+                    static_cast<float>(height) / static_cast<float>(pyramid_height)};
+        }
+
+        [[nodiscard]]
+        inline auto get_levels_cnt() const noexcept {
+            return levels_cnt;
+        }
+
+        // Nothing to test against until the first build
+        [[nodiscard]]
+        inline bool is_built() const noexcept {
+            return built;
+        }
+
+        // Transform of the frame the pyramid was built from
+        [[nodiscard]]
+        inline glm::mat4 const& get_view_projection() const noexcept {
+            return view_projection;
+        }
+
+        // view_projection is the transform the depth buffer was rendered with
+        void build(glm::mat4 const& view_projection) noexcept(false) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, depth_texture.get_id());
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+            copy_program.apply();
+            copy_program.set_uniform<GLint>(copy_program.get_uniform_id("depth"), 0);
+            glBindImageTexture(0, pyramid_texture.get_id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute(groups(pyramid_width), groups(pyramid_height), 1);
+
+            downsample_program.apply();
+            for (GLsizei level{1}; level < levels_cnt; ++level) {
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                glBindImageTexture(0, pyramid_texture.get_id(), level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+                glBindImageTexture(1, pyramid_texture.get_id(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+                glDispatchCompute(groups(level_size(pyramid_width, level)),
+                                  groups(level_size(pyramid_height, level)), 1);
+            }
+
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to build HiZ pyramid");
+
+            this->view_projection = view_projection;
+            built = true;
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
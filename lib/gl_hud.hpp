@@ -0,0 +1,322 @@
+#ifndef GL_HUD__
+#define GL_HUD__
+
+#include "gl_wrappers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Overlay showing FPS, a histogram of the latest frame times, the
+    // frame_stats counters of the previous frame and the GPU memory estimated
+    // by gl_object_registry. Text and bars are colored
+    // quads built on the CPU and drawn with a single draw call, the font is
+    // a built-in 3x5 bitmap, so nothing has to be loaded.
+    // The overlay issues raw GL calls and is not accounted in frame_stats.
+    class hud {
+    public:
+        static constexpr std::size_t history_size{120};
+
+        // Screen pixels per font pixel
+        static constexpr float pixel_size{2.f};
+
+    private:
+        using steady_clock = std::chrono::steady_clock;
+
+        struct rgba {
+            std::uint8_t r, g, b, a;
+        };
+
+        struct vertex {
+            GLfloat x, y;
+            rgba color;
+        };
+
+        static constexpr int glyph_width{3};
+        static constexpr int glyph_height{5};
+        static constexpr unsigned char first_glyph{' '};
+
+        // Rows top to bottom, most significant bit on the left. Covers ' ' to 'Z',
+        // lowercase letters are drawn as uppercase ones.
+        static constexpr std::uint16_t glyphs[]{
+            0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x52a5, 0x0000, 0x0000,
+            0x2922, 0x224a, 0x0000, 0x0000, 0x0000, 0x01c0, 0x0002, 0x12a4,
+            0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7249,
+            0x7bef, 0x7bcf, 0x0410, 0x0000, 0x0000, 0x0e38, 0x0000, 0x0000,
+            0x0000, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4, 0x396b,
+            0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x6b6d, 0x2b6a,
+            0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a, 0x5bfd,
+            0x5aad, 0x5a92, 0x72a7,
+        };
+
+        static constexpr char const *vertex_shader_source{R"(
+#version 430 core
+
+layout (location = 0) in vec2 pos;
+layout (location = 1) in vec4 color;
+
+uniform vec2 screen_size;
+
+out vec4 vertex_color;
+
+void main()
+{
+    // Positions are in pixels from the top left corner
+    gl_Position = vec4(pos / screen_size * vec2(2., -2.) + vec2(-1., 1.), 0., 1.);
+    vertex_color = color;
+}
+)"};
+
+        static constexpr char const *fragment_shader_source{R"(
+#version 430 core
+
+in vec4 vertex_color;
+
+out vec4 frag_color;
+
+void main()
+{
+    frag_color = vertex_color;
+}
+)"};
+
+        // Layout in screen pixels
+        static constexpr float margin{8.f};
+        static constexpr float padding{6.f};
+        static constexpr float glyph_advance{(glyph_width + 1) * pixel_size};
+        static constexpr float line_height{(glyph_height + 2) * pixel_size};
+        static constexpr float bar_width{2.f};
+        static constexpr float ms_to_pixels{2.f};
+        static constexpr float histogram_max_ms{100.f / 3.f};
+        static constexpr float histogram_height{histogram_max_ms * ms_to_pixels};
+        static constexpr float panel_width{38 * glyph_advance + 2 * padding};
+        static constexpr float panel_height{4 * line_height + histogram_height + pixel_size + 2 * padding};
+
+        static constexpr rgba background_color{0, 0, 0, 160};
+        static constexpr rgba text_color{255, 255, 255, 255};
+        static constexpr rgba grid_color{255, 255, 255, 64};
+        static constexpr rgba fast_color{64, 220, 64, 255};
+        static constexpr rgba slow_color{240, 200, 48, 255};
+        static constexpr rgba very_slow_color{240, 64, 48, 255};
+
+        unsigned width;
+        unsigned height;
+
+        shader_program program;
+        GLint screen_size_id;
+        vertex_array_object vao{"hud"};
+        buffer_object vbo{"hud vertices"};
+
+        std::array<float, history_size> frame_times_ms{};
+        std::size_t next_frame{0};
+        std::size_t frames_cnt{0};
+        steady_clock::time_point prev_draw{};
+
+        std::vector<vertex> vertices;
+
+        static constexpr bool is_lit(std::uint16_t const bits, int const row, int const col) noexcept {
+            return (bits >> ((glyph_height - 1 - row) * glyph_width + (glyph_width - 1 - col))) & 1;
+        }
+
+        void add_quad(float const x, float const y, float const w, float const h, rgba const color) {
+            vertex const top_left{x, y, color}, top_right{x + w, y, color},
+                         bottom_left{x, y + h, color}, bottom_right{x + w, y + h, color};
+
+            vertices.insert(std::end(vertices), {top_left, bottom_left, top_right,
+                                                 top_right, bottom_left, bottom_right});
+        }
+
+        void add_text(float x, float const y, char const *text, rgba const color) {
+            for (; *text; ++text, x += glyph_advance) {
+                auto const c{static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(*text)))};
+                if (c < first_glyph || c >= first_glyph + std::size(glyphs))
+                    continue;
+
+                auto const bits{glyphs[c - first_glyph]};
+                for (int row{0}; row < glyph_height; ++row) {
+                    // Adjacent lit pixels of a row make up one quad
+                    for (int col{0}; col < glyph_width;) {
+                        if (!is_lit(bits, row, col)) {
+                            ++col;
+                            continue;
+                        }
+
+                        auto end{col + 1};
+                        while (end < glyph_width && is_lit(bits, row, end))
+                            ++end;
+
+                        add_quad(x + static_cast<float>(col) * pixel_size, y + static_cast<float>(row) * pixel_size,
+                                 static_cast<float>(end - col) * pixel_size, pixel_size, color);
+                        col = end;
+                    }
+                }
+            }
+        }
+
+        // Oldest frame on the left, bars are clamped to histogram_max_ms
+        void add_histogram(float const x, float const y) {
+            auto const bottom{y + histogram_height};
+
+            add_quad(x, bottom - 1000.f / 60.f * ms_to_pixels, history_size * bar_width, 1.f, grid_color);
+            add_quad(x, y, history_size * bar_width, 1.f, grid_color);
+
+            auto const first{frames_cnt < history_size ? 0 : next_frame};
+            for (std::size_t i{0}; i < frames_cnt; ++i) {
+                auto const ms{frame_times_ms[(first + i) % history_size]};
+                auto const bar_height{std::min(ms, histogram_max_ms) * ms_to_pixels};
+                auto const color{ms <= 1000.f / 60.f ? fast_color : ms <= 1000.f / 30.f ? slow_color : very_slow_color};
+
+                add_quad(x + static_cast<float>(i) * bar_width, bottom - bar_height, bar_width, bar_height, color);
+            }
+        }
+
+        void record_frame_time() {
+            auto const now{steady_clock::now()};
+
+            if (prev_draw != steady_clock::time_point{}) {
+                std::chrono::duration<float, std::milli> const frame_time{now - prev_draw};
+                frame_times_ms[next_frame] = frame_time.count();
+                next_frame = (next_frame + 1) % history_size;
+                frames_cnt = std::min(frames_cnt + 1, history_size);
+            }
+            prev_draw = now;
+        }
+
+    public:
+        // Sizes of the framebuffer in pixels, which differ from the window size on HiDPI displays
+        hud(unsigned const width, unsigned const height) noexcept(false)
+                : width{width}, height{height},
+                  program{vertex_shader{std::string{vertex_shader_source}},
+                          fragment_shader{std::string{fragment_shader_source}}},
+                  screen_size_id{static_cast<GLint>(program.get_uniform_id("screen_size"))}
+        {
+            GLint prev_vao;
+            glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prev_vao);
+
+            glBindVertexArray(vao.get_id());
+            glBindBuffer(GL_ARRAY_BUFFER, vbo.get_id());
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), reinterpret_cast<void *>(offsetof(vertex, x)));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(vertex),
+                                  reinterpret_cast<void *>(offsetof(vertex, color)));
+            glEnableVertexAttribArray(1);
+            glBindVertexArray(prev_vao);
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to create HUD");
+        }
+
+        hud(hud const&) = delete;
+        hud& operator=(hud const&) = delete;
+
+        // Call once per frame right before the swap, the time between calls is the frame time.
+        // Program, VAO, array buffer, viewport, depth test, face culling and the blending
+        // switch and function are restored.
+        void draw() noexcept(false) {
+            record_frame_time();
+
+            float avg_ms{0.f}, max_ms{0.f};
+            for (std::size_t i{0}; i < frames_cnt; ++i) {
+                avg_ms += frame_times_ms[i];
+                max_ms = std::max(max_ms, frame_times_ms[i]);
+            }
+            if (frames_cnt)
+                avg_ms /= static_cast<float>(frames_cnt);
+
+            auto const counters{frame_stats::get_last()};
+            char line[64];
+
+            vertices.clear();
+            add_quad(margin, margin, panel_width, panel_height, background_color);
+
+            auto const x{margin + padding};
+            auto y{margin + padding};
+
+            std::snprintf(line, sizeof(line), "FPS %.1f  AVG %.2f MS  MAX %.2f MS",
+                          avg_ms > 0.f ? 1000. / avg_ms : 0., avg_ms, max_ms);
+            add_text(x, y, line, text_color);
+            y += line_height;
+
+            add_histogram(x, y);
+            y += histogram_height + pixel_size;
+
+            std::snprintf(line, sizeof(line), "DRAWS %llu  TRIS %llu",
+                          static_cast<unsigned long long>(counters.draw_calls),
+                          static_cast<unsigned long long>(counters.triangles));
+            add_text(x, y, line, text_color);
+            y += line_height;
+
+            std::snprintf(line, sizeof(line), "STATES %llu  UPLOAD %.1f KB",
+                          static_cast<unsigned long long>(counters.state_changes),
+                          static_cast<double>(counters.uploaded_bytes) / 1024.);
+            add_text(x, y, line, text_color);
+            y += line_height;
+
+            auto const memory{gl_object_registry::get().get_total_usage()};
+            std::snprintf(line, sizeof(line), "GPU MEM %.1f MB  OBJECTS %zu",
+                          static_cast<double>(memory.bytes) / (1024. * 1024.), memory.count);
+            add_text(x, y, line, text_color);
+
+            GLint prev_program, prev_vao, prev_array_buffer;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &prev_program);
+            glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prev_vao);
+            glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &prev_array_buffer);
+            GLint prev_viewport[4];
+            glGetIntegerv(GL_VIEWPORT, prev_viewport);
+            GLint prev_src_rgb, prev_dst_rgb, prev_src_alpha, prev_dst_alpha;
+            glGetIntegerv(GL_BLEND_SRC_RGB, &prev_src_rgb);
+            glGetIntegerv(GL_BLEND_DST_RGB, &prev_dst_rgb);
+            glGetIntegerv(GL_BLEND_SRC_ALPHA, &prev_src_alpha);
+            glGetIntegerv(GL_BLEND_DST_ALPHA, &prev_dst_alpha);
+            auto const depth_test{glIsEnabled(GL_DEPTH_TEST)};
+            auto const blend{glIsEnabled(GL_BLEND)};
+            auto const cull_face{glIsEnabled(GL_CULL_FACE)};
+
+            glViewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+            glDisable(GL_DEPTH_TEST);
+            glDisable(GL_CULL_FACE);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+            glUseProgram(program.get_id());
+            glUniform2f(screen_size_id, static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+            glBindVertexArray(vao.get_id());
+            glBindBuffer(GL_ARRAY_BUFFER, vbo.get_id());
+            // Orphans the storage the previous frame may still be drawn from
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(vertex) * vertices.size()),
+                         vertices.data(), GL_STREAM_DRAW);
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+
+            glBindBuffer(GL_ARRAY_BUFFER, prev_array_buffer);
+            glBindVertexArray(prev_vao);
+            glUseProgram(prev_program);
+            glViewport(prev_viewport[0], prev_viewport[1], prev_viewport[2], prev_viewport[3]);
+            glBlendFuncSeparate(static_cast<GLenum>(prev_src_rgb), static_cast<GLenum>(prev_dst_rgb),
+                                static_cast<GLenum>(prev_src_alpha), static_cast<GLenum>(prev_dst_alpha));
+            if (depth_test)
+                glEnable(GL_DEPTH_TEST);
+            if (cull_face)
+                glEnable(GL_CULL_FACE);
+            if (!blend)
+                glDisable(GL_BLEND);
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to draw HUD");
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
@@ -0,0 +1,162 @@
+#ifndef GL_OBJECT_REGISTRY__
+#define GL_OBJECT_REGISTRY__
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace gl_wrappers {
+
+    enum class gl_object_category : std::uint8_t {
+        buffer, vertex_array, texture, renderbuffer, framebuffer, query, shader, program, categories_cnt
+    };
+
+    // Every GL object alive, created through the wrappers, with the amount of
+    // GPU memory its owner estimates it takes: the size of buffer storage,
+    // texels of all texture levels and so on. Drivers add alignment and
+    // metadata on top, so the totals are a lower bound useful for budgeting.
+    // Objects still registered when the program exits are reported as leaks.
+    class gl_object_registry {
+    public:
+        static constexpr std::size_t categories_cnt{static_cast<std::size_t>(gl_object_category::categories_cnt)};
+
+        using handle = std::uint64_t;
+
+        struct usage {
+            std::size_t count{0};
+            std::size_t bytes{0};
+        };
+
+    private:
+        struct entry {
+            gl_object_category category;
+            std::size_t bytes;
+            std::string label;
+        };
+
+        mutable std::mutex mutex;
+        std::unordered_map<handle, entry> entries;
+        std::array<usage, categories_cnt> usages{};
+        handle next_handle{1};
+
+        gl_object_registry() = default;
+
+        ~gl_object_registry() {
+            if (!entries.empty()) {
+                std::cerr << "Leaked GL objects:\n";
+                report(std::cerr);
+            }
+        }
+
+        static usage& at(std::array<usage, categories_cnt>& usages, gl_object_category const category) noexcept {
+            return usages[static_cast<std::size_t>(category)];
+        }
+
+    public:
+        gl_object_registry(gl_object_registry const&) = delete;
+        gl_object_registry& operator=(gl_object_registry const&) = delete;
+
+        static gl_object_registry& get() {
+            static gl_object_registry registry;
+            return registry;
+        }
+
+        static char const* get_category_name(gl_object_category const category) noexcept {
+            switch (category) {
+                case gl_object_category::buffer:
+                    return "buffer";
+                case gl_object_category::vertex_array:
+                    return "vertex array";
+                case gl_object_category::texture:
+                    return "texture";
+                case gl_object_category::renderbuffer:
+                    return "renderbuffer";
+                case gl_object_category::framebuffer:
+                    return "framebuffer";
+                case gl_object_category::query:
+                    return "query";
+                case gl_object_category::shader:
+                    return "shader";
+                default:
+                    return "program";
+            }
+        }
+
+        [[nodiscard]]
+        handle add(gl_object_category const category, std::string label = {}) {
+            std::lock_guard<std::mutex> const lock{mutex};
+
+            ++at(usages, category).count;
+            entries.emplace(next_handle, entry{category, 0, std::move(label)});
+            return next_handle++;
+        }
+
+        void set_bytes(handle const h, std::size_t const bytes) {
+            std::lock_guard<std::mutex> const lock{mutex};
+
+            if (auto const it{entries.find(h)}; it != std::end(entries)) {
+                auto& category_usage{at(usages, it->second.category)};
+                category_usage.bytes = category_usage.bytes - it->second.bytes + bytes;
+                it->second.bytes = bytes;
+            }
+        }
+
+        void set_label(handle const h, std::string label) {
+            std::lock_guard<std::mutex> const lock{mutex};
+
+            if (auto const it{entries.find(h)}; it != std::end(entries))
+                it->second.label = std::move(label);
+        }
+
+        void remove(handle const h) noexcept {
+            std::lock_guard<std::mutex> const lock{mutex};
+
+            if (auto const it{entries.find(h)}; it != std::end(entries)) {
+                auto& category_usage{at(usages, it->second.category)};
+                --category_usage.count;
+                category_usage.bytes -= it->second.bytes;
+                entries.erase(it);
+            }
+        }
+
+        [[nodiscard]]
+        usage get_usage(gl_object_category const category) const {
+            std::lock_guard<std::mutex> const lock{mutex};
+            return usages[static_cast<std::size_t>(category)];
+        }
+
+        [[nodiscard]]
+        usage get_total_usage() const {
+            std::lock_guard<std::mutex> const lock{mutex};
+
+            usage total;
+            for (auto const& category_usage : usages) {
+                total.count += category_usage.count;
+                total.bytes += category_usage.bytes;
+            }
+            return total;
+        }
+
+        // Per category totals followed by every labeled object
+        void report(std::ostream& os) const {
+            std::lock_guard<std::mutex> const lock{mutex};
+
+            for (std::size_t i{0}; i < categories_cnt; ++i) {
+                if (usages[i].count)
+                    os << "  " << get_category_name(static_cast<gl_object_category>(i)) << ": " <<
+                          usages[i].count << " objects, " << usages[i].bytes << " bytes\n";
+            }
+
+            for (auto const& [h, e] : entries) {
+                if (!e.label.empty())
+                    os << "    " << get_category_name(e.category) << " \"" << e.label << "\": " <<
+                          e.bytes << " bytes\n";
+            }
+        }
+    };
+}
+#endif
@@ -0,0 +1,221 @@
+#ifndef GL_RING_BUFFER__
+#define GL_RING_BUFFER__
+
+#include "gl_wrappers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace gl_wrappers {
+
+#define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
+do {                                                                                           \
+    if(auto const err{glGetError()}; err != GL_NO_ERROR)                                       \
+        throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
+} while(0)
+
+    // Persistently mapped buffer split into regions_cnt per-frame regions.
+    // While the GPU reads region N the CPU fills region N + 1, every region is
+    // guarded by a fence so it is never overwritten before the GPU is done with it.
+    // The region size is rounded up to the uniform and storage buffer offset
+    // alignments, so every region starts suitably aligned for binding ranges.
+    class ring_buffer {
+    public:
+        static constexpr std::size_t regions_cnt{3};
+
+    private:
+        buffer_object buffer;
+        std::size_t region_size;
+        std::uint8_t *mapped_ptr;
+        std::array<GLsync, regions_cnt> fences{};
+        std::size_t region_idx{0};
+        std::size_t head{0};
+
+        static inline auto create_buffer(std::size_t const size) noexcept(false) {
+            if (!GLEW_ARB_buffer_storage)
+                throw std::runtime_error("ring_buffer requires GL_ARB_buffer_storage");
+
+            buffer_object buffer{"ring_buffer"};
+            buffer.set_storage(GL_COPY_WRITE_BUFFER, size, nullptr,
+                               GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to allocate ring_buffer storage");
+
+            return buffer;
+        }
+
+        inline auto map_buffer() noexcept(false) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get_id());
+            auto const ptr{glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, region_size * regions_cnt,
+                                            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)};
+            if (!ptr)
+                throw std::runtime_error("Failed to map ring_buffer storage");
+
+            return static_cast<std::uint8_t *>(ptr);
+        }
+
+        static inline void wait_fence(GLsync &fence) noexcept(false) {
+            if (!fence)
+                return;
+
+            for (GLbitfield flags{0};; flags = GL_SYNC_FLUSH_COMMANDS_BIT) {
+                auto const ret{glClientWaitSync(fence, flags, 1'000'000)};
+                if (ret == GL_ALREADY_SIGNALED || ret == GL_CONDITION_SATISFIED)
+                    break;
+                if (ret == GL_WAIT_FAILED)
+                    throw std::runtime_error("Failed to wait for ring_buffer region fence");
+            }
+
+            glDeleteSync(std::exchange(fence, nullptr));
+        }
+
+        // Storage itself is deleted along with the buffer_object
+        inline void destroy() noexcept(true) {
+            if (!buffer.get_id())
+                return;
+
+            for (auto &fence : fences)
+                if (fence)
+                    glDeleteSync(std::exchange(fence, nullptr));
+
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get_id());
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+
+        static inline std::size_t round_up(std::size_t const size, std::size_t const alignment) noexcept {
+            return (size + alignment - 1) / alignment * alignment;
+        }
+
+        static inline std::size_t align_region_size(std::size_t const size) noexcept {
+            auto const alignment{std::max(get_uniform_alignment(), get_storage_alignment())};
+            return round_up(size, static_cast<std::size_t>(std::max(alignment, GLint{1})));
+        }
+
+        [[nodiscard]]
+        inline auto region_begin() const noexcept {
+            return region_idx * region_size;
+        }
+
+    public:
+        // The buffer is a member object, so it is deleted if mapping it throws
+        explicit ring_buffer(std::size_t const region_size)
+                : buffer{create_buffer(align_region_size(region_size) * regions_cnt)},
+                  region_size{align_region_size(region_size)},
+                  mapped_ptr{map_buffer()}
+        { }
+
+        ring_buffer(ring_buffer const&) = delete;
+        ring_buffer& operator=(ring_buffer const&) = delete;
+
+        ring_buffer(ring_buffer&& o) noexcept
+                : buffer{std::move(o.buffer)},
+                  region_size{o.region_size},
+                  mapped_ptr{std::exchange(o.mapped_ptr, nullptr)},
+                  fences{std::exchange(o.fences, {})},
+                  region_idx{o.region_idx},
+                  head{o.head}
+        { }
+
+        ring_buffer& operator=(ring_buffer&& o) noexcept {
+            if (this == &o)
+                return *this;
+
+            destroy();
+            buffer = std::move(o.buffer);
+            region_size = o.region_size;
+            mapped_ptr = std::exchange(o.mapped_ptr, nullptr);
+            fences = std::exchange(o.fences, {});
+            region_idx = o.region_idx;
+            head = o.head;
+            return *this;
+        }
+
+        ~ring_buffer() {
+            destroy();
+        }
+
+        [[nodiscard]]
+        inline auto get_id() const noexcept {
+            return buffer.get_id();
+        }
+
+        [[nodiscard]]
+        inline auto get_region_size() const noexcept {
+            return region_size;
+        }
+
+        // Blocks until the GPU has released the current region, must be called
+        // once per frame before any allocation.
+        void begin_frame() noexcept(false) {
+            wait_fence(fences[region_idx]);
+            head = 0;
+        }
+
+        // Fences everything submitted so far against the current region and
+        // moves on to the next one.
+        void end_frame() noexcept(false) {
+            fences[region_idx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            if (!fences[region_idx])
+                throw std::runtime_error("Failed to create ring_buffer region fence");
+
+            region_idx = (region_idx + 1) % regions_cnt;
+        }
+
+        // Returns offset from the beginning of the buffer aligned to alignment, suitable
+        // for glBindBufferRange or as a vertex/indirect buffer offset.
+        [[nodiscard]]
+        std::size_t allocate(std::size_t const size, std::size_t const alignment = 16) noexcept(false) {
+            // Aligns the offset into the whole buffer, alignment may exceed the one of the region
+            auto const aligned_head{round_up(region_begin() + head, alignment) - region_begin()};
+
+            if (aligned_head > region_size || size > region_size - aligned_head)
+                throw std::runtime_error("ring_buffer region overflow: requested "s + std::to_string(size) +
+                                         " bytes, "s + std::to_string(region_size - head) + " left"s);
+
+            head = aligned_head + size;
+            return region_begin() + aligned_head;
+        }
+
+        [[nodiscard]]
+        inline void *data(std::size_t const offset) noexcept {
+            return mapped_ptr + offset;
+        }
+
+        template<typename T>
+        [[nodiscard]]
+        std::size_t push(T const *src, std::size_t const count, std::size_t const alignment = alignof(T)) noexcept(false) {
+            static_assert(std::is_trivially_copyable_v<T>, "ring_buffer may only hold trivially copyable data");
+
+            auto const offset{allocate(sizeof(T) * count, alignment)};
+            std::memcpy(data(offset), src, sizeof(T) * count);
+            frame_stats::count_upload(sizeof(T) * count);
+            return offset;
+        }
+
+        void bind_range(GLenum const target, GLuint const index,
+                        std::size_t const offset, std::size_t const size) noexcept(false) {
+            glBindBufferRange(target, index, buffer.get_id(), offset, size);
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to bind ring_buffer range");
+            frame_stats::count_state_changes();
+        }
+
+        static GLint get_uniform_alignment() noexcept {
+            GLint val;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &val);
+            return val;
+        }
+
+        static GLint get_storage_alignment() noexcept {
+            GLint val;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &val);
+            return val;
+        }
+    };
+
+#undef GL_THROW_EXCEPTION_ON_ERROR
+}
+#endif
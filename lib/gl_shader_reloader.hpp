@@ -0,0 +1,141 @@
+#ifndef GL_SHADER_RELOADER__
+#define GL_SHADER_RELOADER__
+
+#include "gl_wrappers.hpp"
+#include "shader_preprocessor.hpp"
+#include "file_watcher.hpp"
+#include "async_logger.hpp"
+
+#include <atomic>
+#include <exception>
+#include <initializer_list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gl_wrappers {
+
+    // A shader_program rebuilt whenever one of its source files, included ones
+    // too, is saved. Files are read and preprocessed on the watcher thread, the
+    // GL thread only compiles and links in update(), which is meant to be called
+    // at the frame boundary so a frame never mixes two programs. A program failing to compile is
+    // logged and the previous one is kept, so a typo never stops the demo.
+    class reloadable_program {
+    public:
+        struct stage {
+            GLenum type;
+            std::string path;
+            gl_helpers::shader_defines defines{};
+        };
+
+    private:
+        std::vector<stage> const stages;
+        gl_helpers::shader_preprocessor const preprocessor;
+        shader_program program;
+
+        std::mutex mutex;
+        std::optional<std::vector<std::string>> pending_sources;
+        std::atomic<bool> has_pending{false};
+
+        // Declared last, so its thread is stopped before the rest is destroyed
+        std::optional<gl_helpers::file_watcher> watcher;
+
+        struct sources_t {
+            std::vector<std::string> sources;
+            // Every file the sources were read from, includes too
+            std::vector<std::string> files;
+        };
+
+        // Variants embedded at build time are only good until the first change.
+        // Does not touch watcher, as it runs before watcher is constructed.
+        sources_t read_sources(bool const embedded = false) const noexcept(false) {
+            sources_t result;
+            for (auto const& s : stages) {
+                auto shader{embedded ? preprocessor.get_variant(s.path, s.defines)
+                                     : preprocessor.process(s.path, s.defines)};
+                result.sources.push_back(std::move(shader.source));
+                for (auto const& file : shader.files)
+                    result.files.push_back(file.string());
+            }
+            return result;
+        }
+
+        static shader_program build(std::vector<stage> const& stages,
+                                    std::vector<std::string> const& sources) noexcept(false) {
+            std::vector<basic_shader> shaders;
+            for (std::size_t i{0}; i < stages.size(); ++i)
+                shaders.emplace_back(stages[i].type, sources[i]);
+            return shader_program{shaders};
+        }
+
+        void on_change(std::string const& path) {
+            GL_LOG(info, "Shader ", path, " changed, reloading");
+
+            try {
+                auto read{read_sources()};
+
+                // Includes may have been added since the last time
+                for (auto const& file : read.files)
+                    watcher->watch(file);
+
+                std::lock_guard<std::mutex> const lock{mutex};
+                pending_sources = std::move(read.sources);
+                has_pending.store(true, std::memory_order_release);
+            } catch (std::exception const& e) {
+                GL_LOG(error, "Failed to read shader sources: ", e.what());
+            }
+        }
+
+    public:
+        // Without watching the files the program is built once and never changes,
+        // from the embedded variants if there are ones
+        reloadable_program(std::initializer_list<stage> const stages, bool const watch = true) noexcept(false)
+                : stages{stages}, program{build(this->stages, read_sources(!watch).sources)} {
+            if (!watch)
+                return;
+
+            watcher.emplace([this](std::string const& path) { on_change(path); });
+            for (auto const& s : this->stages) {
+                for (auto const& file : preprocessor.process(s.path, s.defines).files)
+                    watcher->watch(file.string());
+            }
+        }
+
+        reloadable_program(reloadable_program const&) = delete;
+        reloadable_program& operator=(reloadable_program const&) = delete;
+
+        // Returns true when the program has been replaced: uniform locations and
+        // values have to be set up again, as they belong to the program object.
+        // Costs a single atomic load when nothing changed.
+        bool update() {
+            if (!has_pending.load(std::memory_order_acquire))
+                return false;
+
+            std::vector<std::string> sources;
+            {
+                std::lock_guard<std::mutex> const lock{mutex};
+                sources = std::move(*pending_sources);
+                pending_sources.reset();
+                has_pending.store(false, std::memory_order_relaxed);
+            }
+
+            try {
+                program = build(stages, sources);
+            } catch (std::exception const& e) {
+                GL_LOG(error, "Shader reload failed, keeping the previous program: ", e.what());
+                return false;
+            }
+
+            GL_LOG(info, "Shader program reloaded");
+            return true;
+        }
+
+        [[nodiscard]]
+        shader_program& get() noexcept {
+            return program;
+        }
+    };
+}
+#endif
@@ -4,14 +4,28 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "spsc_queue.hpp"
+#include "gl_object_registry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <iostream>
-#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 using std::literals::string_literals::operator""s;
+using std::literals::string_view_literals::operator""sv;
 namespace gl_wrappers {
 
 #define GL_THROW_EXCEPTION_ON_ERROR(msg)                                                       \
@@ -20,10 +34,192 @@ do {
         throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
 } while(0)
 
+    struct frame_counters {
+        std::uint64_t draw_calls{0};
+        std::uint64_t triangles{0};
+        std::uint64_t state_changes{0};
+        std::uint64_t uploaded_bytes{0};
+    };
+
+    // Work issued through the wrappers during a frame. Counters are kept per
+    // thread, as every thread renders into its own context, and are rolled over
+    // by end_frame(), which bench_harness calls once per frame.
+    class frame_stats {
+    private:
+        static frame_counters& current() noexcept {
+            thread_local frame_counters counters;
+            return counters;
+        }
+
+        static frame_counters& last() noexcept {
+            thread_local frame_counters counters;
+            return counters;
+        }
+
+    public:
+        [[nodiscard]]
+        static constexpr std::uint64_t get_triangles_cnt(GLenum const mode, std::uint64_t const vertices) noexcept {
+            switch (mode) {
+                case GL_TRIANGLES:
+                    return vertices / 3;
+                case GL_TRIANGLE_STRIP:
+                case GL_TRIANGLE_FAN:
+                    return vertices > 2 ? vertices - 2 : 0;
+                default:
+                    return 0;
+            }
+        }
+
+        static void count_draws(std::uint64_t const cnt, std::uint64_t const triangles = 0) noexcept {
+            current().draw_calls += cnt;
+            current().triangles += triangles;
+        }
+
+        static void count_state_changes(std::uint64_t const cnt = 1) noexcept {
+            current().state_changes += cnt;
+        }
+
+        static void count_upload(std::uint64_t const bytes) noexcept {
+            current().uploaded_bytes += bytes;
+        }
+
+        static void end_frame() noexcept {
+            last() = std::exchange(current(), {});
+        }
+
+        // Counters of the latest completed frame
+        [[nodiscard]]
+        static frame_counters get_last() noexcept {
+            return last();
+        }
+    };
+
+    template<gl_object_category CATEGORY>
+    struct gl_object_traits;
+
+    template<>
+    struct gl_object_traits<gl_object_category::buffer> {
+        static void generate(GLuint *const id) noexcept { glGenBuffers(1, id); }
+        static void destroy(GLuint const id) noexcept { glDeleteBuffers(1, &id); }
+    };
+
+    template<>
+    struct gl_object_traits<gl_object_category::vertex_array> {
+        static void generate(GLuint *const id) noexcept { glGenVertexArrays(1, id); }
+        static void destroy(GLuint const id) noexcept { glDeleteVertexArrays(1, &id); }
+    };
+
+    template<>
+    struct gl_object_traits<gl_object_category::texture> {
+        static void generate(GLuint *const id) noexcept { glGenTextures(1, id); }
+        static void destroy(GLuint const id) noexcept { glDeleteTextures(1, &id); }
+    };
+
+    template<>
+    struct gl_object_traits<gl_object_category::renderbuffer> {
+        static void generate(GLuint *const id) noexcept { glGenRenderbuffers(1, id); }
+        static void destroy(GLuint const id) noexcept { glDeleteRenderbuffers(1, &id); }
+    };
+
+    template<>
+    struct gl_object_traits<gl_object_category::framebuffer> {
+        static void generate(GLuint *const id) noexcept { glGenFramebuffers(1, id); }
+        static void destroy(GLuint const id) noexcept { glDeleteFramebuffers(1, &id); }
+    };
+
+    template<>
+    struct gl_object_traits<gl_object_category::query> {
+        static void generate(GLuint *const id) noexcept { glGenQueries(1, id); }
+        static void destroy(GLuint const id) noexcept { glDeleteQueries(1, &id); }
+    };
+
+    // Owns a GL object name and keeps it in gl_object_registry along with the
+    // memory estimate given by set_size(). Has to be created and destroyed with
+    // its context current; release() gives up an object that is going to be
+    // freed along with its context.
+    template<gl_object_category CATEGORY>
+    class gl_object {
+    private:
+        using traits = gl_object_traits<CATEGORY>;
+
+        GLuint id{0};
+        gl_object_registry::handle handle{0};
+
+        void reset() noexcept {
+            if (!id)
+                return;
+
+            traits::destroy(release());
+        }
+
+    public:
+        explicit gl_object(std::string label = {}) noexcept(false) {
+            traits::generate(&id);
+            if (!id)
+                throw std::runtime_error("Failed to create GL "s + gl_object_registry::get_category_name(CATEGORY));
+
+            handle = gl_object_registry::get().add(CATEGORY, std::move(label));
+        }
+
+        gl_object(gl_object const&) = delete;
+        gl_object& operator=(gl_object const&) = delete;
+
+        gl_object(gl_object&& o) noexcept
+                : id{std::exchange(o.id, 0)}, handle{std::exchange(o.handle, 0)}
+        { }
+
+        gl_object& operator=(gl_object&& o) noexcept {
+            if (this == &o)
+                return *this;
+
+            reset();
+            id = std::exchange(o.id, 0);
+            handle = std::exchange(o.handle, 0);
+            return *this;
+        }
+
+        ~gl_object() {
+            reset();
+        }
+
+        [[nodiscard]]
+        inline GLuint get_id() const noexcept {
+            return id;
+        }
+
+        // Estimated GPU memory taken by the object
+        void set_size(std::size_t const bytes) {
+            gl_object_registry::get().set_bytes(handle, bytes);
+        }
+
+        void set_label(std::string label) {
+            gl_object_registry::get().set_label(handle, std::move(label));
+        }
+
+        // Unregisters the object without deleting it and returns its name
+        GLuint release() noexcept {
+            gl_object_registry::get().remove(std::exchange(handle, 0));
+            return std::exchange(id, 0);
+        }
+    };
+
+    using vertex_array_object = gl_object<gl_object_category::vertex_array>;
+    using renderbuffer_object = gl_object<gl_object_category::renderbuffer>;
+    using framebuffer_object = gl_object<gl_object_category::framebuffer>;
+    using query_object = gl_object<gl_object_category::query>;
+
+    // A SPIR-V module for GL_ARB_gl_spirv, size is in bytes
+    struct spirv_module {
+        void const *data;
+        std::size_t size;
+        char const *entry_point{"main"};
+    };
+
     class basic_shader {
     private:
         GLuint shader_type;
         GLuint shader_id;
+        gl_object_registry::handle handle{0};
 
         inline auto create_shader() {
             auto const val{glCreateShader(shader_type)};
@@ -41,15 +237,14 @@ do {
             return val;
         }
 
-        static inline void destroy_shader(GLuint const id) noexcept(true) {
-            if(id != GL_INVALID_INDEX )
-                glDeleteShader(id);
+        inline void destroy_shader() noexcept(true) {
+            if(shader_id != GL_INVALID_INDEX )
+                glDeleteShader(std::exchange(shader_id, GL_INVALID_INDEX));
+            gl_object_registry::get().remove(std::exchange(handle, 0));
         }
 
-        inline void compile_shader(char const *c_str) {
+        inline void check_compile_status() {
             auto const id{shader_id};
-            glShaderSource(id, 1, &c_str, nullptr);
-            glCompileShader(id);
 
             if (GLint success; !(glGetShaderiv(id, GL_COMPILE_STATUS, &success), success)) {
                 char msg[GL_INFO_LOG_LENGTH];
@@ -58,14 +253,51 @@ do {
             }
         }
 
+        inline void compile_shader(char const *c_str) {
+            auto const id{shader_id};
+            glShaderSource(id, 1, &c_str, nullptr);
+            glCompileShader(id);
+            check_compile_status();
+        }
+
+        // Skips parsing GLSL: the driver only translates the already validated module
+        inline void specialize_shader(spirv_module const& module) {
+            if (!GLEW_ARB_gl_spirv)
+                throw std::runtime_error("SPIR-V shaders require GL_ARB_gl_spirv");
+
+            auto const id{shader_id};
+            glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module.data, static_cast<GLsizei>(module.size));
+            glSpecializeShaderARB(id, module.entry_point, 0, nullptr, nullptr);
+            check_compile_status();
+        }
+
+        template<typename F>
+        inline void build_shader(F&& compile) {
+            try {
+                compile();
+            } catch (...) {
+                destroy_shader();
+                throw;
+            }
+            handle = gl_object_registry::get().add(gl_object_category::shader);
+        }
+
         template<typename T, typename = int>
         struct has_c_str : std::false_type{};
 
     public:
-        template<typename STR>
+        template<typename STR,
+                 typename = std::enable_if_t<!std::is_same_v<std::decay_t<STR>, spirv_module>>>
         basic_shader(unsigned const shader_type, STR &&shader_code) :
                 shader_type{shader_type}, shader_id{create_shader()} {
-            compile_shader(shader_code.c_str());
+            build_shader([&] { compile_shader(shader_code.c_str()); });
+        }
+
+        // Uniforms of SPIR-V shaders are not guaranteed to be found by name,
+        // they have to be addressed by explicit locations and bindings
+        basic_shader(unsigned const shader_type, spirv_module const& module) :
+                shader_type{shader_type}, shader_id{create_shader()} {
+            build_shader([&] { specialize_shader(module); });
         }
 
         basic_shader(basic_shader const& o) = delete;
@@ -73,12 +305,15 @@ do {
 
         basic_shader(basic_shader&& o) noexcept
                 : shader_type{std::move(o.shader_type)},
-                  shader_id{std::exchange(o.shader_id, GL_INVALID_INDEX)}
+                  shader_id{std::exchange(o.shader_id, GL_INVALID_INDEX)},
+                  handle{std::exchange(o.handle, 0)}
         { }
 
         basic_shader& operator=(basic_shader&& o) noexcept {
+            destroy_shader();
             shader_type = std::move(o.shader_type);
             shader_id = std::exchange(o.shader_id, GL_INVALID_INDEX);
+            handle = std::exchange(o.handle, 0);
             return *this;
         }
 
@@ -93,7 +328,7 @@ do {
         }
 
         ~basic_shader() {
-            destroy_shader(shader_id);
+            destroy_shader();
         };
     };
 
@@ -113,10 +348,19 @@ do {
         { }
     };
 
+    class compute_shader : public basic_shader
+    {
+    public:
+        template<typename T>
+        inline compute_shader(T &&shader_code) : basic_shader{GL_COMPUTE_SHADER, std::forward<T>(shader_code)}
+        { }
+    };
+
 
     class shader_program {
     private:
         GLuint program_id;
+        gl_object_registry::handle handle{0};
 
         static inline auto create_program() noexcept(false) {
             auto const val{glCreateProgram()};
@@ -129,7 +373,8 @@ do {
 
         inline void destroy_program() noexcept(true) {
             if( program_id != GL_INVALID_INDEX)
-                glDeleteProgram(program_id);
+                glDeleteProgram(std::exchange(program_id, GL_INVALID_INDEX));
+            gl_object_registry::get().remove(std::exchange(handle, 0));
         }
 
         template <typename T>
@@ -150,6 +395,10 @@ do {
 
             (attach_shader(std::forward<Args>(args)), ...);
 
+            link_program();
+        }
+
+        inline void link_program() noexcept(false) {
             glLinkProgram(program_id);
 
             if(GLint success; !(glGetProgramiv(program_id, GL_LINK_STATUS, &success), success)) {
@@ -166,29 +415,55 @@ do {
                 throw std::runtime_error("Failed to use program: GL returned code "s + std::to_string(err));
         }
 
-    public:
-        template<typename ...Args,
-                typename = std::enable_if_t<std::conjunction_v<is_shader<Args>...>>>
-        shader_program(Args&&...args)
-                : program_id{create_program()}  {
+        template<typename F>
+        inline void build_program(F&& compile) noexcept(false) {
             try {
-                compile_program(std::forward<Args>(args)...);
+                compile();
             } catch (std::exception const& e) {
                 std::cerr << "Failed to create shader_program: "s + e.what() << std::endl;
                 destroy_program();
                 throw std::runtime_error{"Unable to construct shader_program"};
             }
+
+            // The size of the linked binary is the closest estimate of the memory the program takes
+            GLint binary_size{0};
+            glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+
+            auto& registry{gl_object_registry::get()};
+            handle = registry.add(gl_object_category::program);
+            registry.set_bytes(handle, static_cast<std::size_t>(binary_size));
+        }
+
+    public:
+        template<typename ...Args,
+                typename = std::enable_if_t<std::conjunction_v<is_shader<Args>...>>>
+        shader_program(Args&&...args)
+                : program_id{create_program()}  {
+            build_program([&] { compile_program(std::forward<Args>(args)...); });
+        }
+
+        // For stages known only at run time, e.g. read from a list of files
+        explicit shader_program(std::vector<basic_shader> const& shaders)
+                : program_id{create_program()}  {
+            build_program([&] {
+                for (auto const& shader : shaders)
+                    attach_shader(shader);
+                link_program();
+            });
         }
 
         shader_program() = delete;
         shader_program(shader_program const& o) = delete;
         shader_program& operator=(shader_program const& o) = delete;
 
-        shader_program(shader_program&& o) noexcept : program_id{std::exchange(o.program_id, GL_INVALID_INDEX)}
+        shader_program(shader_program&& o) noexcept
+                : program_id{std::exchange(o.program_id, GL_INVALID_INDEX)}, handle{std::exchange(o.handle, 0)}
         { }
 
         shader_program& operator=(shader_program&& o) noexcept {
+            destroy_program();
             program_id = std::exchange(o.program_id, GL_INVALID_INDEX);
+            handle = std::exchange(o.handle, 0);
             return *this;
         }
 
@@ -199,6 +474,7 @@ do {
 
         void apply() {
             use_program();
+            frame_stats::count_state_changes();
         }
 
         ~shader_program() {
@@ -246,9 +522,12 @@ do {
             CHOOSE_UNIFORM_FUNC(args_cnt, b);
         else if constexpr (std::is_same_v<T, GLint>)
             CHOOSE_UNIFORM_FUNC(args_cnt, i);
+        else if constexpr (std::is_same_v<T, GLuint>)
+            CHOOSE_UNIFORM_FUNC(args_cnt, ui);
 #undef CHOOSE_UNIFORM_FUNC
 
             GL_THROW_EXCEPTION_ON_ERROR("Failed to set uniform");
+            frame_stats::count_state_changes();
         }
 
         template<typename T,
@@ -274,6 +553,190 @@ do {
 #undef CHOOSE_MAT_UNIFORM_FUNC
 
             GL_THROW_EXCEPTION_ON_ERROR("Failed to set uniform");
+            frame_stats::count_state_changes();
+        }
+
+        template<typename T,
+                std::size_t SIZE>
+        void set_vector_uniform(GLuint const uniform_id, GLsizei count, T const* ptr) {
+            static_assert(1 < SIZE && SIZE < 5, "Vector uniform may have from 2 to 4 components");
+
+#define CHOOSE_VEC_UNIFORM_FUNC(size, last_letter, ...)           \
+        do {                                                      \
+            if constexpr (size == 2)                              \
+                glUniform2##last_letter(__VA_ARGS__);             \
+            else if constexpr (size == 3)                         \
+                glUniform3##last_letter(__VA_ARGS__);             \
+            else if constexpr (size == 4)                         \
+                glUniform4##last_letter(__VA_ARGS__);             \
+        } while(0)
+
+            if constexpr (std::is_same_v<T, GLfloat>)
+                CHOOSE_VEC_UNIFORM_FUNC(SIZE, fv, uniform_id, count, ptr);
+            else if constexpr (std::is_same_v<T, GLint>)
+                CHOOSE_VEC_UNIFORM_FUNC(SIZE, iv, uniform_id, count, ptr);
+            else if constexpr (std::is_same_v<T, GLuint>)
+                CHOOSE_VEC_UNIFORM_FUNC(SIZE, uiv, uniform_id, count, ptr);
+#undef CHOOSE_VEC_UNIFORM_FUNC
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to set uniform");
+            frame_stats::count_state_changes();
+        }
+    };
+
+    // Counted counterparts of the GL calls demos issue every frame. They are on
+    // the hot path, so unlike the classes above they leave errors unchecked.
+    inline void draw_arrays(GLenum const mode, GLint const first, GLsizei const count) noexcept {
+        glDrawArrays(mode, first, count);
+        frame_stats::count_draws(1, frame_stats::get_triangles_cnt(mode, count));
+    }
+
+    inline void draw_elements(GLenum const mode, GLsizei const count, GLenum const type,
+                              std::size_t const offset = 0) noexcept {
+        glDrawElements(mode, count, type, reinterpret_cast<void const *>(offset));
+        frame_stats::count_draws(1, frame_stats::get_triangles_cnt(mode, count));
+    }
+
+    inline void bind_vertex_array(GLuint const vao) noexcept {
+        glBindVertexArray(vao);
+        frame_stats::count_state_changes();
+    }
+
+    inline void bind_texture(GLuint const unit, GLenum const target, GLuint const texture) noexcept {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        frame_stats::count_state_changes();
+    }
+
+    inline void buffer_data(GLenum const target, GLsizeiptr const size, void const *const data,
+                            GLenum const usage) noexcept {
+        glBufferData(target, size, data, usage);
+        if (data)
+            frame_stats::count_upload(static_cast<std::uint64_t>(size));
+    }
+
+    class buffer_object : public gl_object<gl_object_category::buffer> {
+    public:
+        using gl_object::gl_object;
+
+        // Leaves the buffer bound to target
+        void set_data(GLenum const target, GLsizeiptr const size, void const *const data,
+                      GLenum const usage) noexcept(false) {
+            glBindBuffer(target, get_id());
+            buffer_data(target, size, data, usage);
+            set_size(static_cast<std::size_t>(size));
+        }
+
+        // Immutable storage, leaves the buffer bound to target
+        void set_storage(GLenum const target, GLsizeiptr const size, void const *const data,
+                         GLbitfield const flags) noexcept(false) {
+            glBindBuffer(target, get_id());
+            glBufferStorage(target, size, data, flags);
+            if (data)
+                frame_stats::count_upload(static_cast<std::uint64_t>(size));
+            set_size(static_cast<std::size_t>(size));
+        }
+    };
+
+    class texture_object : public gl_object<gl_object_category::texture> {
+    public:
+        using gl_object::gl_object;
+
+        // Texels of a 2D texture, of its whole mipmap chain if mipmapped
+        [[nodiscard]]
+        static std::size_t estimate_size(std::size_t width, std::size_t height, std::size_t const bytes_per_texel,
+                                         bool const mipmapped) noexcept {
+            auto size{width * height * bytes_per_texel};
+
+            while (mipmapped && (width > 1 || height > 1)) {
+                width = std::max<std::size_t>(width / 2, 1);
+                height = std::max<std::size_t>(height / 2, 1);
+                size += width * height * bytes_per_texel;
+            }
+            return size;
+        }
+    };
+
+    // Color and depth render target replacing the default framebuffer
+    // of contexts that have no surface to draw into
+    class offscreen_framebuffer {
+    private:
+        GLFWwindow *context;
+        unsigned width;
+        unsigned height;
+
+        renderbuffer_object color_rb{"offscreen color"};
+        renderbuffer_object depth_rb{"offscreen depth"};
+        framebuffer_object fbo{"offscreen"};
+
+    public:
+        // Has to be created with the owner context current
+        offscreen_framebuffer(GLFWwindow *const context, unsigned const width, unsigned const height)
+                : context{context}, width{width}, height{height}
+        {
+            // Both formats take 4 bytes per pixel
+            glBindRenderbuffer(GL_RENDERBUFFER, color_rb.get_id());
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            color_rb.set_size(std::size_t{width} * height * 4);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth_rb.get_id());
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            depth_rb.set_size(std::size_t{width} * height * 4);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo.get_id());
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb.get_id());
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                                      depth_rb.get_id());
+
+            if (auto const status{glCheckFramebufferStatus(GL_FRAMEBUFFER)}; status != GL_FRAMEBUFFER_COMPLETE)
+                throw std::runtime_error("Offscreen framebuffer is incomplete: status "s + std::to_string(status));
+
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to create offscreen framebuffer");
+        }
+
+        offscreen_framebuffer(offscreen_framebuffer const&) = delete;
+        offscreen_framebuffer& operator=(offscreen_framebuffer const&) = delete;
+
+        // Without the owner context current the objects are left to be freed along with the context
+        ~offscreen_framebuffer() {
+            if (glfwGetCurrentContext() == context)
+                return;
+
+            fbo.release();
+            depth_rb.release();
+            color_rb.release();
+        }
+
+        inline void bind() const noexcept {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo.get_id());
+        }
+
+        [[nodiscard]]
+        inline auto get_id() const noexcept {
+            return fbo.get_id();
+        }
+
+        [[nodiscard]]
+        inline auto get_width() const noexcept {
+            return width;
+        }
+
+        [[nodiscard]]
+        inline auto get_height() const noexcept {
+            return height;
+        }
+
+        // Tightly packed RGBA rows, bottom row first
+        [[nodiscard]]
+        std::vector<std::uint8_t> read_pixels() const noexcept(false) {
+            std::vector<std::uint8_t> pixels(std::size_t{width} * height * 4);
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo.get_id());
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            GL_THROW_EXCEPTION_ON_ERROR("Failed to read offscreen framebuffer");
+
+            return pixels;
         }
     };
 
@@ -296,16 +759,95 @@ do {
         virtual ~glfw_scroll_callback() = default;
     };
 
+    struct glfw_event {
+        enum class event_type : std::uint8_t { key, cursor_pos, scroll };
+
+        event_type type;
+        int key, scan_code, action, mode;
+        double x, y;
+        double time;    // glfwGetTime() when the event was received
+    };
+
+    // Time from receiving an input event till the swap of the first frame it had a chance to affect
+    struct input_latency_stats {
+        double last{0.};
+        double avg{0.};
+        double max{0.};
+        std::size_t samples{0};
+    };
+
     class glfw_window {
+    public:
+        static constexpr std::size_t events_capacity{1024};
+
+        // per_event - cursor callback is invoked for every queued motion event;
+        // coalesced - all motion queued since the last dispatch is merged into the
+        //             latest position and the callback is invoked once per dispatch
+        enum class cursor_input { per_event, coalesced };
+
     private:
-        using key_callback_wrapper_fn = GLFWkeyfun;
         friend class glfw;
         std::unique_ptr<GLFWwindow, decltype(glfwDestroyWindow)*> ptr_window;
 
-        // Some kind of workaround to make callback wrapper
-        static inline std::map<GLFWwindow*, std::pair<glfw_window*, glfw_key_callback*>> key_callback_map;
-        static inline std::map<GLFWwindow*, std::pair<glfw_window*, glfw_cursor_pos_callback*>> cursor_pos_map;
-        static inline std::map<GLFWwindow*, std::pair<glfw_window*, glfw_scroll_callback*>> scroll_map;
+        // Windows are not resizable, and querying the size is allowed only
+        // from the main thread, so it is taken once at creation. The framebuffer
+        // size is in pixels, it is larger than the window size on HiDPI displays.
+        unsigned width;
+        unsigned height;
+        unsigned framebuffer_width;
+        unsigned framebuffer_height;
+
+        // Set up by glfw::set_context() for headless backends, declared after
+        // ptr_window to be destroyed while the context still exists
+        std::unique_ptr<offscreen_framebuffer> offscreen;
+
+        // GLFW callbacks only append to the queue, user callbacks are invoked
+        // later from dispatch_events()
+        gl_helpers::spsc_queue<glfw_event, events_capacity> events;
+        std::atomic<std::size_t> dropped_events_cnt{0};
+
+        glfw_key_callback        *key_callback{nullptr};
+        glfw_cursor_pos_callback *cursor_pos_callback{nullptr};
+        glfw_scroll_callback     *scroll_callback{nullptr};
+
+        // The only thread allowed to consume events: the creating one until a
+        // context is made current, then the one it is current on
+        std::atomic<std::thread::id> events_consumer{std::this_thread::get_id()};
+
+        // Handler of dispatch_events() forwarding to the callbacks set by the user
+        struct registered_callbacks {
+            glfw_window& window;
+
+            void on_key(glfw_window& w, int const key, int const scan_code, int const action, int const mode) {
+                if (window.key_callback)
+                    (*window.key_callback)(w, key, scan_code, action, mode);
+            }
+
+            void on_cursor_pos(glfw_window& w, double const x_pos, double const y_pos) {
+                if (window.cursor_pos_callback)
+                    (*window.cursor_pos_callback)(w, x_pos, y_pos);
+            }
+
+            void on_scroll(glfw_window& w, double const x_off, double const y_off) {
+                if (window.scroll_callback)
+                    (*window.scroll_callback)(w, x_off, y_off);
+            }
+        };
+
+        cursor_input cursor_input_mode{cursor_input::per_event};
+
+        // Receive time of the oldest event dispatched since the previous swap, negative if none
+        double oldest_pending_input{-1.};
+        input_latency_stats input_latency{};
+
+        static inline void push_event(GLFWwindow* const ptr, glfw_event const& event) noexcept {
+            auto const window{static_cast<glfw_window*>(glfwGetWindowUserPointer(ptr))};
+
+            if (!window->events.push(event))
+                window->dropped_events_cnt.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void install_callbacks() noexcept;
 
         static void key_callback_thunk(GLFWwindow* const ptr, int key, int scancode, int action, int mode);
 
@@ -315,29 +857,6 @@ do {
 
         explicit glfw_window(unsigned width = 800, unsigned height = 600, std::string const& title = "untitled");
 
-        template<typename MAP_T, typename INTERNAL_SET_CALLBACK, typename CALLBACK, typename CALLBACK_THUNK>
-        inline CALLBACK* set_internal_callback(MAP_T &map, INTERNAL_SET_CALLBACK& internal_setter,
-                                               CALLBACK_THUNK* callback_thunk, CALLBACK* callback) {
-            if (auto const map_it{map.find(ptr_window.get())};
-                    map_it != std::end(map)) {
-                if (callback)
-                    std::swap(callback, std::get<1>(map_it->second));
-                else {
-                    callback = std::get<1>(map_it->second);
-                    map.erase(map_it);
-                }
-                return callback;
-            }
-
-            if (!callback)
-                internal_setter(ptr_window.get(), nullptr);
-            else {
-                map.insert({ptr_window.get(), std::make_pair(this, callback)});
-                internal_setter(ptr_window.get(), callback_thunk);
-            }
-            return nullptr;
-        }
-
 
     public:
         glfw_window() = delete;
@@ -349,8 +868,28 @@ do {
 
         void disable_cursor();
 
+        void set_cursor_input(cursor_input mode) noexcept;
+
+        // Unscaled and unaccelerated motion, takes effect only while the cursor is disabled.
+        // Returns false if the platform does not support it.
+        bool set_raw_mouse_motion(bool const enable);
+
+        // Also accounts input latency of the events dispatched during the frame
         void swap_buffers();
 
+        // 0 - no vsync, 1 - sync to every vertical blank, N - every N-th;
+        // negative - adaptive, swaps immediately when a frame is late. Requires the
+        // window context to be current. Returns the interval actually applied,
+        // adaptive falls back to regular vsync if the driver does not support it.
+        int set_swap_interval(int interval) noexcept(false);
+
+        [[nodiscard]]
+        input_latency_stats const& get_input_latency() const noexcept;
+
+        // Render target of a headless window, nullptr for a regular one
+        [[nodiscard]]
+        offscreen_framebuffer const* get_offscreen_framebuffer() const noexcept;
+
         void set_should_be_closed(bool const val);
 
         glfw_key_callback* set_key_callback(glfw_key_callback*);
@@ -359,9 +898,26 @@ do {
 
         glfw_scroll_callback* set_scroll_callback(glfw_scroll_callback*);
 
-        unsigned get_width();
+        // Invokes user callbacks for all events queued since the previous call
+        void dispatch_events();
+
+        // Passes all events queued since the previous call to handler.on_key(),
+        // on_cursor_pos() and on_scroll(), which take the same arguments as the
+        // callbacks. The calls are resolved at compile time, so unlike the
+        // registered callbacks they cost no virtual dispatch and may be inlined.
+        template<typename HANDLER>
+        void dispatch_events(HANDLER&& handler);
+
+        std::size_t get_dropped_events_cnt() const noexcept;
+
+        unsigned get_width() const noexcept;
+
+        unsigned get_height() const noexcept;
 
-        unsigned get_height();
+        // Size to use for viewports and render targets
+        unsigned get_framebuffer_width() const noexcept;
+
+        unsigned get_framebuffer_height() const noexcept;
 
         bool should_be_closed();
 
@@ -372,16 +928,49 @@ do {
 
     class glfw {
     public:
+        // window          - regular window on the native platform;
+        // headless_egl    - no display needed, EGL surfaceless context (GPU or llvmpipe);
+        // headless_osmesa - no display needed, OSMesa software context.
+        // Headless backends render into an offscreen framebuffer and require GLFW 3.4.
+        enum class backend { window, headless_egl, headless_osmesa };
+
+        // Name of the environment variable used when no backend was set explicitly:
+        // "window", "egl" or "osmesa"
+        static constexpr char const *backend_env_var{"GL_TUTORIALS_BACKEND"};
 
         static inline std::string get_last_error();
 
+        // Has to be called before the first window is created
+        static void set_backend(backend b) noexcept(false);
+
+        [[nodiscard]]
+        static backend get_backend() noexcept(false);
+
         [[nodiscard]]
         static window_shared_ptr_t create_window(std::string const &title, unsigned width = 800, unsigned height = 600);
 
+        // Also dispatches input events queued for every window whose events this
+        // thread consumes, see set_context(). On a render thread started by
+        // run_render_thread() only dispatches, since OS events are processed by
+        // the main thread there.
         static void poll_events();
 
+        // As above, but events of the current context window go to handler, see
+        // glfw_window::dispatch_events(HANDLER&&), other windows use their callbacks
+        template<typename HANDLER>
+        static void poll_events(HANDLER&& handler);
+
+        // Runs render() on a new thread, which has to make window's context current
+        // and may use poll_events() as usual, while the calling (main) thread keeps
+        // processing OS events until render() returns. A swap blocked on vsync then
+        // no longer delays input, and slow event handling does not stall the frame.
+        // Exceptions thrown by render() are rethrown here.
+        template<typename FUNC>
+        static void run_render_thread(window_shared_ptr_t const& window, FUNC&& render) noexcept(false);
+
         static double get_time();
 
+        // The calling thread also becomes the consumer of the window's input events
         static void set_context(window_shared_ptr_t const& window);
 
         static window_weak_ptr_t get_context();
@@ -389,10 +978,19 @@ do {
         static void reset_context();
     private:
         struct glew_lib {
-            glew_lib() {
+            explicit glew_lib(bool const headless) {
                 glewExperimental = GL_TRUE;
 
-                if (auto const ret{glewInit()}; ret != GLEW_OK) {
+                auto const ret{glewInit()};
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+                // GLEW built for GLX loads the GL entry points and only then fails
+                // to find the GLX display, which an EGL or OSMesa context does not have
+                if (headless && ret == GLEW_ERROR_NO_GLX_DISPLAY)
+                    return;
+#else
+                static_cast<void>(headless);
+#endif
+                if (ret != GLEW_OK) {
                     throw std::runtime_error("Failed to init GLEW lib: "s +
                                              reinterpret_cast<char const *>(glewGetErrorString(ret)));
                 }
@@ -407,18 +1005,32 @@ do {
             }
 
         public:
+            backend const used_backend;
 
-            glfw_internal() {
+            explicit glfw_internal(backend const b) : used_backend{b} {
+                glfwSetErrorCallback(error_callback);
 
-                if (!glfwInit())
-                    throw std::runtime_error("Failed to init GLFW lib");
+                if (used_backend != backend::window) {
+#ifdef GLFW_PLATFORM_NULL
+                    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+                    throw std::runtime_error("Headless backends require GLFW 3.4 or newer");
+#endif
+                }
 
-                glfwSetErrorCallback(error_callback);
+                if (!glfwInit())
+                    throw std::runtime_error("Failed to init GLFW lib: " + get_error_msg());
 
                 glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
                 glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
                 glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
                 glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+
+                if (used_backend != backend::window) {
+                    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+                    glfwWindowHint(GLFW_CONTEXT_CREATION_API, used_backend == backend::headless_egl ?
+                                                              GLFW_EGL_CONTEXT_API : GLFW_OSMESA_CONTEXT_API);
+                }
             }
 
             static std::string get_error_msg() {
@@ -430,20 +1042,136 @@ do {
             }
         };
 
-        inline static glfw_internal internal{};
+        inline static std::optional<backend> requested_backend{};
+        inline static std::atomic<bool> initialized{false};
+
+        static backend backend_from_env() noexcept(false) {
+            auto const env{std::getenv(backend_env_var)};
+
+            if (!env || env == "window"sv)
+                return backend::window;
+            if (env == "egl"sv)
+                return backend::headless_egl;
+            if (env == "osmesa"sv)
+                return backend::headless_osmesa;
+
+            throw std::runtime_error("Unknown "s + backend_env_var + " value: " + env);
+        }
+
+        // Initialized on the first window creation rather than at program start,
+        // so code merely linked with the wrappers does not need a display
+        static glfw_internal& get_internal() {
+            static glfw_internal internal{requested_backend ? *requested_backend : backend_from_env()};
+            initialized = true;
+            return internal;
+        }
+
         inline static thread_local window_shared_ptr_t context_window{nullptr};
+        inline static thread_local bool is_render_thread{false};
+
+        inline static std::mutex windows_mutex;
+        inline static std::vector<window_weak_ptr_t> windows;
+
+        // Calls func for every live window whose events are consumed by this thread
+        template<typename FUNC>
+        static void for_each_consumed_window(FUNC&& func) {
+            // Reused, so polling does not allocate every frame
+            thread_local std::vector<window_shared_ptr_t> consumed;
+            auto const this_thread{std::this_thread::get_id()};
+
+            {
+                std::lock_guard<std::mutex> const lock{windows_mutex};
+                windows.erase(std::remove_if(std::begin(windows), std::end(windows),
+                                             [](auto const& w) { return w.expired(); }),
+                              std::end(windows));
+
+                for (auto const& w : windows) {
+                    if (auto window{w.lock()};
+                        window && window->events_consumer.load(std::memory_order_relaxed) == this_thread)
+                        consumed.push_back(std::move(window));
+                }
+            }
+
+            for (auto const& window : consumed)
+                func(*window);
+            consumed.clear();
+        }
     };
 
-    glfw_window::glfw_window(glfw_window &&o) : ptr_window{std::exchange(o.ptr_window, nullptr)}
-    { }
+    // Events still queued in the source window are lost on move
+    glfw_window::glfw_window(glfw_window &&o) : ptr_window{std::exchange(o.ptr_window, nullptr)},
+                                                width{o.width},
+                                                height{o.height},
+                                                framebuffer_width{o.framebuffer_width},
+                                                framebuffer_height{o.framebuffer_height},
+                                                offscreen{std::move(o.offscreen)},
+                                                key_callback{std::exchange(o.key_callback, nullptr)},
+                                                cursor_pos_callback{std::exchange(o.cursor_pos_callback, nullptr)},
+                                                scroll_callback{std::exchange(o.scroll_callback, nullptr)},
+                                                events_consumer{o.events_consumer.load()}
+    {
+        if (ptr_window)
+            glfwSetWindowUserPointer(ptr_window.get(), this);
+    }
 
     glfw_window &glfw_window::operator=(glfw_window &&o) {
         ptr_window = std::exchange(o.ptr_window, nullptr);
+        width = o.width;
+        height = o.height;
+        framebuffer_width = o.framebuffer_width;
+        framebuffer_height = o.framebuffer_height;
+        offscreen = std::move(o.offscreen);
+        key_callback = std::exchange(o.key_callback, nullptr);
+        cursor_pos_callback = std::exchange(o.cursor_pos_callback, nullptr);
+        scroll_callback = std::exchange(o.scroll_callback, nullptr);
+        events_consumer = o.events_consumer.load();
+
+        if (ptr_window)
+            glfwSetWindowUserPointer(ptr_window.get(), this);
         return *this;
     }
 
     void glfw_window::swap_buffers() {
-        glfwSwapBuffers(ptr_window.get());
+        // Nothing to present offscreen, only make sure the frame is submitted
+        if (offscreen)
+            glFlush();
+        else
+            glfwSwapBuffers(ptr_window.get());
+
+        if (oldest_pending_input < 0.)
+            return;
+
+        // Return from the swap is the closest to present that can be seen without extra GPU sync
+        auto const latency{glfwGetTime() - oldest_pending_input};
+        oldest_pending_input = -1.;
+
+        auto& stats{input_latency};
+        stats.last = latency;
+        stats.max = std::max(stats.max, latency);
+        stats.avg += (latency - stats.avg) / static_cast<double>(++stats.samples);
+    }
+
+    int glfw_window::set_swap_interval(int interval) {
+        if (glfwGetCurrentContext() != ptr_window.get())
+            throw std::runtime_error("Swap interval may be set only for the current context window");
+
+        if (offscreen)
+            return 0;
+
+        if (interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+                            !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+            interval = -interval;
+
+        glfwSwapInterval(interval);
+        return interval;
+    }
+
+    input_latency_stats const& glfw_window::get_input_latency() const noexcept {
+        return input_latency;
+    }
+
+    offscreen_framebuffer const* glfw_window::get_offscreen_framebuffer() const noexcept {
+        return offscreen.get();
     }
 
     void glfw_window::set_should_be_closed(const bool val) {
@@ -452,70 +1180,141 @@ do {
 
     glfw_window::glfw_window(const unsigned int width, const unsigned int height, const std::string &title)
             : ptr_window{glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr),
-                         glfwDestroyWindow}
+                         glfwDestroyWindow},
+              width{width},
+              height{height},
+              framebuffer_width{width},
+              framebuffer_height{height}
     {
         if (!ptr_window)
             throw std::runtime_error("Failed to create window: " + glfw::get_last_error());
+
+        int actual_width, actual_height;
+        glfwGetWindowSize(ptr_window.get(), &actual_width, &actual_height);
+
+        if (!actual_width || !actual_height)
+            throw std::runtime_error(glfw::get_last_error());
+
+        this->width = static_cast<unsigned>(actual_width);
+        this->height = static_cast<unsigned>(actual_height);
+
+        glfwGetFramebufferSize(ptr_window.get(), &actual_width, &actual_height);
+        if (actual_width && actual_height) {
+            framebuffer_width = static_cast<unsigned>(actual_width);
+            framebuffer_height = static_cast<unsigned>(actual_height);
+        } else {
+            framebuffer_width = this->width;
+            framebuffer_height = this->height;
+        }
+
+        install_callbacks();
     }
 
-    glfw_window::~glfw_window() {
-        key_callback_map.erase(ptr_window.get());
-        cursor_pos_map.erase(ptr_window.get());
+    glfw_window::~glfw_window() = default;
+
+    void glfw_window::install_callbacks() noexcept {
+        glfwSetWindowUserPointer(ptr_window.get(), this);
+        glfwSetKeyCallback(ptr_window.get(), key_callback_thunk);
+        glfwSetCursorPosCallback(ptr_window.get(), cursor_pos_thunk);
+        glfwSetScrollCallback(ptr_window.get(), scroll_thunk);
     }
 
     bool glfw_window::should_be_closed() {
         return glfwWindowShouldClose(ptr_window.get());
     }
 
-    unsigned glfw_window::get_width() {
-        int width;
-        glfwGetWindowSize(ptr_window.get(), &width, nullptr);
+    unsigned glfw_window::get_width() const noexcept {
+        return width;
+    }
 
-        if (!width)
-            throw std::runtime_error(glfw::get_last_error());
+    unsigned glfw_window::get_height() const noexcept {
+        return height;
+    }
 
-        return static_cast<unsigned>(width);
+    unsigned glfw_window::get_framebuffer_width() const noexcept {
+        return framebuffer_width;
     }
 
-    unsigned glfw_window::get_height() {
-        int height;
-        glfwGetWindowSize(ptr_window.get(), nullptr, &height);
+    unsigned glfw_window::get_framebuffer_height() const noexcept {
+        return framebuffer_height;
+    }
 
-        if (!height)
-            throw std::runtime_error(glfw::get_last_error());
+    void glfw_window::key_callback_thunk(GLFWwindow* const ptr, int key, int scancode, int action, int mode) {
+        push_event(ptr, {glfw_event::event_type::key, key, scancode, action, mode, 0., 0., glfwGetTime()});
+    }
 
-        return static_cast<unsigned>(height);
+    void glfw_window::cursor_pos_thunk(GLFWwindow *const ptr, double x_pos, double y_pos) {
+        push_event(ptr, {glfw_event::event_type::cursor_pos, 0, 0, 0, 0, x_pos, y_pos, glfwGetTime()});
     }
 
-    void glfw_window::key_callback_thunk(GLFWwindow* const ptr, int key, int scancode, int action, int mode) {
-        auto &[obj, callback]{key_callback_map[ptr]};
+    void glfw_window::scroll_thunk(GLFWwindow *const ptr, double x_off, double y_off) {
+        push_event(ptr, {glfw_event::event_type::scroll, 0, 0, 0, 0, x_off, y_off, glfwGetTime()});
+    }
 
-        (callback)->operator()(*obj, key, scancode, action, mode);
+    void glfw_window::dispatch_events() {
+        dispatch_events(registered_callbacks{*this});
     }
 
-    void glfw_window::cursor_pos_thunk(GLFWwindow *const ptr, double x_pos, double y_pos) {
-        auto &[obj, callback]{cursor_pos_map[ptr]};
+    template<typename HANDLER>
+    void glfw_window::dispatch_events(HANDLER&& handler) {
+        bool const coalesce_cursor{cursor_input_mode == cursor_input::coalesced};
+        bool cursor_moved{false};
+        double cursor_x{}, cursor_y{};
+
+        events.consume_all([&](glfw_event const& event) {
+            if (oldest_pending_input < 0.)
+                oldest_pending_input = event.time;
 
-        callback->operator()(*obj, x_pos, y_pos);
+            switch (event.type) {
+                case glfw_event::event_type::key:
+                    handler.on_key(*this, event.key, event.scan_code, event.action, event.mode);
+                    break;
+                case glfw_event::event_type::cursor_pos:
+                    // Positions are absolute, so the latest one carries the sum of all deltas
+                    if (coalesce_cursor) {
+                        cursor_moved = true;
+                        cursor_x = event.x;
+                        cursor_y = event.y;
+                    } else {
+                        handler.on_cursor_pos(*this, event.x, event.y);
+                    }
+                    break;
+                case glfw_event::event_type::scroll:
+                    handler.on_scroll(*this, event.x, event.y);
+                    break;
+            }
+        });
+
+        if (cursor_moved)
+            handler.on_cursor_pos(*this, cursor_x, cursor_y);
     }
 
-    void glfw_window::scroll_thunk(GLFWwindow *const ptr, double x_off, double y_off) {
-        auto &[obj, callback]{scroll_map[ptr]};
+    void glfw_window::set_cursor_input(cursor_input const mode) noexcept {
+        cursor_input_mode = mode;
+    }
+
+    bool glfw_window::set_raw_mouse_motion(bool const enable) {
+        if (!glfwRawMouseMotionSupported())
+            return false;
 
-        callback->operator()(*obj, x_off, y_off);
+        glfwSetInputMode(ptr_window.get(), GLFW_RAW_MOUSE_MOTION, enable ? GLFW_TRUE : GLFW_FALSE);
+        return true;
     }
 
+    std::size_t glfw_window::get_dropped_events_cnt() const noexcept {
+        return dropped_events_cnt.load(std::memory_order_relaxed);
+    }
 
     glfw_key_callback* glfw_window::set_key_callback(glfw_key_callback* callback) {
-        return set_internal_callback(key_callback_map, glfwSetKeyCallback, key_callback_thunk, callback);
+        return std::exchange(key_callback, callback);
     }
 
     glfw_cursor_pos_callback* glfw_window::set_cursor_pos_callback(glfw_cursor_pos_callback* callback) {
-        return set_internal_callback(cursor_pos_map, glfwSetCursorPosCallback, cursor_pos_thunk, callback);
+        return std::exchange(cursor_pos_callback, callback);
     }
 
     glfw_scroll_callback* glfw_window::set_scroll_callback(glfw_scroll_callback* callback) {
-        return set_internal_callback(scroll_map, glfwSetScrollCallback, scroll_thunk, callback);
+        return std::exchange(scroll_callback, callback);
     }
 
     void glfw_window::disable_cursor() {
@@ -524,15 +1323,81 @@ do {
     }
 
     window_shared_ptr_t glfw::create_window(const std::string &title, unsigned int width, unsigned int height) {
-        return window_shared_ptr_t {new glfw_window{width, height, title}};
+        get_internal();
+        window_shared_ptr_t window{new glfw_window{width, height, title}};
+
+        std::lock_guard<std::mutex> const lock{windows_mutex};
+        windows.push_back(window);
+        return window;
     }
 
     std::string glfw::get_last_error() {
-        return {internal.get_error_msg()};
+        return {glfw_internal::get_error_msg()};
+    }
+
+    void glfw::set_backend(backend const b) {
+        if (initialized)
+            throw std::runtime_error("GLFW backend cannot be changed after the first window is created");
+
+        requested_backend = b;
+    }
+
+    glfw::backend glfw::get_backend() {
+        return get_internal().used_backend;
     }
 
     void glfw::poll_events() {
-        glfwPollEvents();
+        if (!is_render_thread)
+            glfwPollEvents();
+
+        for_each_consumed_window([](glfw_window& window) { window.dispatch_events(); });
+    }
+
+    template<typename HANDLER>
+    void glfw::poll_events(HANDLER&& handler) {
+        if (!is_render_thread)
+            glfwPollEvents();
+
+        for_each_consumed_window([&handler](glfw_window& window) {
+            if (&window == context_window.get())
+                window.dispatch_events(handler);
+            else
+                window.dispatch_events();
+        });
+    }
+
+    template<typename FUNC>
+    void glfw::run_render_thread(window_shared_ptr_t const& window, FUNC&& render) {
+        // A context may be current on one thread only
+        if (glfwGetCurrentContext() == window->ptr_window.get())
+            reset_context();
+
+        std::atomic<bool> render_done{false};
+        std::exception_ptr render_error{nullptr};
+
+        std::thread render_thread{[&] {
+            is_render_thread = true;
+
+            try {
+                render();
+            } catch (...) {
+                render_error = std::current_exception();
+            }
+
+            // The context has to be released before the window can be destroyed on the main thread
+            reset_context();
+            render_done.store(true, std::memory_order_release);
+            glfwPostEmptyEvent();
+        }};
+
+        // The render thread posts an empty event when done to wake this loop up
+        while (!render_done.load(std::memory_order_acquire))
+            glfwWaitEvents();
+
+        render_thread.join();
+
+        if (render_error)
+            std::rethrow_exception(render_error);
     }
 
     double glfw::get_time() {
@@ -541,9 +1406,23 @@ do {
 
     void glfw::set_context(const window_shared_ptr_t &window) {
         context_window = window;
+        context_window->events_consumer.store(std::this_thread::get_id(), std::memory_order_relaxed);
         glfwMakeContextCurrent(context_window->ptr_window.get());
 
-        static glew_lib glew{};
+        static glew_lib glew{get_backend() != backend::window};
+
+        // Surfaceless contexts have no default framebuffer, so everything
+        // drawn to framebuffer 0 by the demos is redirected to an FBO. The
+        // viewport of such a context starts out empty, as there is no surface
+        // to take the size from, so it has to be set to the FBO explicitly.
+        if (get_backend() != backend::window) {
+            if (!context_window->offscreen)
+                context_window->offscreen = std::make_unique<offscreen_framebuffer>(
+                        context_window->ptr_window.get(), context_window->framebuffer_width,
+                        context_window->framebuffer_height);
+            context_window->offscreen->bind();
+            glViewport(0, 0, context_window->offscreen->get_width(), context_window->offscreen->get_height());
+        }
     }
 
     window_weak_ptr_t glfw::get_context() {
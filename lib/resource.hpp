@@ -0,0 +1,104 @@
+#ifndef GL_RESOURCE__
+#define GL_RESOURCE__
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace gl_helpers {
+
+    // Bytes owned by someone else, a stand-in for C++20 std::span<std::byte const>
+    class byte_view {
+    private:
+        unsigned char const *ptr{nullptr};
+        std::size_t bytes_cnt{0};
+
+    public:
+        constexpr byte_view() noexcept = default;
+
+        constexpr byte_view(unsigned char const *const data, std::size_t const size) noexcept
+                : ptr{data}, bytes_cnt{size}
+        { }
+
+        [[nodiscard]]
+        constexpr unsigned char const* data() const noexcept {
+            return ptr;
+        }
+
+        [[nodiscard]]
+        constexpr std::size_t size() const noexcept {
+            return bytes_cnt;
+        }
+
+        [[nodiscard]]
+        constexpr bool empty() const noexcept {
+            return bytes_cnt == 0;
+        }
+
+        constexpr unsigned char const* begin() const noexcept {
+            return ptr;
+        }
+
+        constexpr unsigned char const* end() const noexcept {
+            return ptr + bytes_cnt;
+        }
+
+        [[nodiscard]]
+        constexpr byte_view subview(std::size_t const offset, std::size_t const size) const noexcept {
+            return {ptr + offset, size};
+        }
+
+        [[nodiscard]]
+        std::string_view get_text() const noexcept {
+            return {reinterpret_cast<char const*>(ptr), bytes_cnt};
+        }
+    };
+
+    // A file compiled into the executable by the embed_resources() CMake function
+    struct resource {
+        std::string_view name;
+        unsigned char const *data;
+        std::size_t size;
+
+        [[nodiscard]]
+        constexpr byte_view get_bytes() const noexcept {
+            return {data, size};
+        }
+
+        [[nodiscard]]
+        std::string_view get_text() const noexcept {
+            return get_bytes().get_text();
+        }
+    };
+}
+
+#ifdef GL_EMBEDDED_RESOURCES
+#include "embedded_resources.hpp"
+#endif
+
+namespace gl_helpers {
+
+    // Null if the executable has no resource of this name
+    [[nodiscard]]
+    constexpr resource const* find_resource(std::string_view const name) noexcept {
+#ifdef GL_EMBEDDED_RESOURCES
+        for (auto const& res : embedded_resources::resources) {
+            if (res.name == name)
+                return &res;
+        }
+#else
+        static_cast<void>(name);
+#endif
+        return nullptr;
+    }
+
+    [[nodiscard]]
+    inline resource const& get_resource(std::string_view const name) noexcept(false) {
+        if (auto const res{find_resource(name)})
+            return *res;
+
+        throw std::runtime_error("No embedded resource " + std::string{name});
+    }
+}
+#endif
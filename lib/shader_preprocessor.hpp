@@ -0,0 +1,207 @@
+#ifndef GL_SHADER_PREPROCESSOR__
+#define GL_SHADER_PREPROCESSOR__
+
+#include "gl_helpers.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Generated at build time from shaders/variants.txt when the EMBED_SHADERS CMake option is on
+#ifdef GL_EMBEDDED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
+
+namespace gl_helpers {
+
+    // Name and value pairs, a define without a value is written as an empty string
+    using shader_defines = std::vector<std::pair<std::string, std::string>>;
+
+    struct preprocessed_shader {
+        std::string source;
+        // Every file the source is made of. The index of a file is its source
+        // string number in #line directives, so "1(12)" in a compiler log is
+        // line 12 of files[1].
+        std::vector<std::filesystem::path> files;
+    };
+
+    // Expands #include "file" directives and injects defines right after the
+    // #version line, which GLSL requires to come first. Included files are
+    // looked up next to the including file, then in the include directories,
+    // and each of them is pasted at most once, so no include guards are needed.
+    // Defines select variants of one source, letting the compiler drop the
+    // code of the disabled features instead of branching on uniforms.
+    class shader_preprocessor {
+    private:
+        std::vector<std::filesystem::path> include_dirs;
+
+        mutable std::mutex mutex;
+        mutable std::map<std::string, preprocessed_shader> variants;
+
+        static std::string_view trim(std::string_view str) noexcept {
+            auto const begin{str.find_first_not_of(" \t\r")};
+            if (begin == std::string_view::npos)
+                return {};
+            return str.substr(begin, str.find_last_not_of(" \t\r") - begin + 1);
+        }
+
+        // Returns the argument of a directive, or nothing if the line is not one
+        static std::optional<std::string_view> get_directive(std::string_view line, std::string_view const name) {
+            line = trim(line);
+            if (line.empty() || line.front() != '#')
+                return std::nullopt;
+
+            line = trim(line.substr(1));
+            if (line.substr(0, name.size()) != name ||
+                (line.size() > name.size() && line[name.size()] != ' ' && line[name.size()] != '\t'))
+                return std::nullopt;
+
+            return trim(line.substr(name.size()));
+        }
+
+        std::filesystem::path find_file(std::filesystem::path const& name,
+                                        std::filesystem::path const& including_dir) const noexcept(false) {
+            if (std::filesystem::exists(including_dir / name))
+                return (including_dir / name).lexically_normal();
+
+            for (auto const& dir : include_dirs) {
+                if (std::filesystem::exists(dir / name))
+                    return (dir / name).lexically_normal();
+            }
+
+            throw std::runtime_error("Cannot find shader file " + name.string());
+        }
+
+        static void write_defines(std::ostream& os, shader_defines const& defines) {
+            for (auto const& [name, value] : defines)
+                os << "#define " << name << ' ' << value << '\n';
+        }
+
+        // Returns whether the root file has had no #version to put the defines after
+        bool expand(std::filesystem::path const& path, preprocessed_shader& result, std::ostringstream& os,
+                    shader_defines const *defines) const noexcept(false) {
+            if (std::find(std::begin(result.files), std::end(result.files), path) != std::end(result.files))
+                return false;
+
+            auto const file_idx{result.files.size()};
+            result.files.push_back(path);
+
+            std::istringstream is{get_text_from_file(path.string())};
+            std::size_t line_idx{0};
+
+            // Only the root file gets defines, a #line before its #version would be an error
+            if (!defines)
+                os << "#line 1 " << file_idx << '\n';
+
+            for (std::string line; std::getline(is, line); ) {
+                ++line_idx;
+
+                if (defines && get_directive(line, "version")) {
+                    os << line << '\n';
+                    write_defines(os, *defines);
+                    os << "#line " << line_idx + 1 << ' ' << file_idx << '\n';
+                    defines = nullptr;
+                } else if (auto const arg{get_directive(line, "include")}) {
+                    if (arg->size() < 2 || arg->front() != '"' || arg->back() != '"')
+                        throw std::runtime_error(path.string() + ':' + std::to_string(line_idx) +
+                                                 ": expected #include \"file\"");
+
+                    expand(find_file(arg->substr(1, arg->size() - 2), path.parent_path()), result, os, nullptr);
+                    os << "#line " << line_idx + 1 << ' ' << file_idx << '\n';
+                } else {
+                    os << line << '\n';
+                }
+            }
+
+            return defines != nullptr;
+        }
+
+    public:
+        [[nodiscard]]
+        static std::vector<std::filesystem::path> get_default_include_dirs() {
+#ifdef GL_SHADERS_DIR
+            return {"shaders", GL_SHADERS_DIR};
+#else
+            return {"shaders"};
+#endif
+        }
+
+        explicit shader_preprocessor(std::vector<std::filesystem::path> include_dirs = get_default_include_dirs())
+                : include_dirs{std::move(include_dirs)}
+        { }
+
+        // Names the variant: the file followed by its defines sorted by name
+        [[nodiscard]]
+        static std::string get_permutation_key(std::string const& filename, shader_defines defines) {
+            std::sort(std::begin(defines), std::end(defines));
+
+            auto key{filename};
+            for (auto const& [name, value] : defines)
+                key += '|' + (value.empty() ? name : name + '=' + value);
+            return key;
+        }
+
+        // Always reads the files again, the root file is searched in the include
+        // directories unless it is found relative to the working directory
+        [[nodiscard]]
+        preprocessed_shader process(std::string const& filename, shader_defines const& defines = {}) const noexcept(false) {
+            preprocessed_shader result;
+            std::ostringstream os;
+
+            if (expand(find_file(filename, {}), result, os, &defines)) {
+                std::ostringstream prefix;
+                write_defines(prefix, defines);
+                prefix << "#line 1 0\n";
+                result.source = prefix.str() + os.str();
+            } else {
+                result.source = os.str();
+            }
+
+            return result;
+        }
+
+#ifdef GL_EMBEDDED_SHADERS
+        // The variant checked and embedded at build time, null if it is not listed in variants.txt
+        [[nodiscard]]
+        static embedded_shaders::variant const* find_embedded(std::string const& filename,
+                                                              shader_defines const& defines = {}) {
+            auto const key{get_permutation_key(filename, defines)};
+
+            for (auto const& v : embedded_shaders::variants) {
+                if (v.key == key)
+                    return &v;
+            }
+            return nullptr;
+        }
+#endif
+
+        // Processes each variant once, later calls return the same source.
+        // Embedded variants are taken as they are, without touching the files,
+        // so their list of files is empty. process() always reads the files.
+        [[nodiscard]]
+        preprocessed_shader const& get_variant(std::string const& filename, shader_defines const& defines = {}) const
+                noexcept(false) {
+            auto key{get_permutation_key(filename, defines)};
+
+            std::lock_guard<std::mutex> const lock{mutex};
+            if (auto const it{variants.find(key)}; it != std::end(variants))
+                return it->second;
+
+#ifdef GL_EMBEDDED_SHADERS
+            if (auto const embedded{find_embedded(filename, defines)})
+                return variants.emplace(std::move(key), preprocessed_shader{std::string{embedded->source}, {}})
+                        .first->second;
+#endif
+            return variants.emplace(std::move(key), process(filename, defines)).first->second;
+        }
+    };
+}
+#endif
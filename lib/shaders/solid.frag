@@ -0,0 +1,16 @@
+#version 430 core
+
+// SOLID_COLOR - the color baked into the shader, otherwise it is taken from the "color" uniform
+
+out vec4 frag_color;
+
+#ifdef SOLID_COLOR
+const vec4 color = SOLID_COLOR;
+#else
+uniform vec4 color;
+#endif
+
+void main()
+{
+    frag_color = color;
+}
@@ -2,8 +2,8 @@
 
 out vec4 frag_color;
 
-in vec3 vertex_color;
-in vec2 vertex_texture_pos;
+#define VARYING in
+#include "textured_varyings.glsl"
 
 uniform sampler2D uniform_texture0;
 uniform sampler2D uniform_texture1;
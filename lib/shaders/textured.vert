@@ -0,0 +1,41 @@
+#version 430 core
+
+// TRANSFORMED - positions are multiplied by the "transform" uniform
+// MULTI_DRAW  - positions are multiplied by the "projection" and "view" uniforms and by the model
+//               matrix taken from the per_draw_data storage buffer at MODEL_INDEX, which has to be
+//               defined as gl_DrawIDARB or gl_BaseInstanceARB
+
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec2 texture_pos;
+
+#define VARYING out
+#include "textured_varyings.glsl"
+
+#if defined(MULTI_DRAW)
+layout (std430, binding = 0) readonly buffer per_draw_data {
+    mat4 models[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+#elif defined(TRANSFORMED)
+uniform mat4 transform;
+#endif
+
+void main()
+{
+#if defined(MULTI_DRAW)
+    gl_Position        = projection * view * models[MODEL_INDEX] * vec4(pos, 1.0);
+#elif defined(TRANSFORMED)
+    gl_Position        = transform * vec4(pos, 1.0);
+#else
+    gl_Position        = vec4(pos, 1.0);
+#endif
+    vertex_color       = color;
+    vertex_texture_pos = texture_pos;
+}
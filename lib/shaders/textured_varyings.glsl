@@ -0,0 +1,3 @@
+// Passed from textured.vert to textured.frag, VARYING is "out" in the former and "in" in the latter
+VARYING vec3 vertex_color;
+VARYING vec2 vertex_texture_pos;
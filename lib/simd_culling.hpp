@@ -0,0 +1,349 @@
+#ifndef GL_SIMD_CULLING__
+#define GL_SIMD_CULLING__
+
+#include "frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GL_HELPERS_CULLING_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GL_HELPERS_CULLING_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GL_HELPERS_CULLING_NEON
+#endif
+
+namespace gl_helpers {
+
+    // Bounding volumes are kept as structure of arrays, so each component
+    // of several objects can be loaded into a single SIMD register
+    class bounding_spheres {
+    public:
+        std::vector<float> x, y, z, radius;
+
+        void reserve(std::size_t const cnt) {
+            x.reserve(cnt);
+            y.reserve(cnt);
+            z.reserve(cnt);
+            radius.reserve(cnt);
+        }
+
+        void push_back(glm::vec3 const& center, float const r) {
+            x.push_back(center.x);
+            y.push_back(center.y);
+            z.push_back(center.z);
+            radius.push_back(r);
+        }
+
+        [[nodiscard]]
+        std::size_t size() const noexcept {
+            return x.size();
+        }
+    };
+
+    // Axis aligned boxes stored as center and half extent
+    class bounding_boxes {
+    public:
+        std::vector<float> x, y, z;
+        std::vector<float> extent_x, extent_y, extent_z;
+
+        void reserve(std::size_t const cnt) {
+            for (auto vec : {&x, &y, &z, &extent_x, &extent_y, &extent_z})
+                vec->reserve(cnt);
+        }
+
+        void push_back(glm::vec3 const& min, glm::vec3 const& max) {
+            x.push_back((min.x + max.x) * 0.5f);
+            y.push_back((min.y + max.y) * 0.5f);
+            z.push_back((min.z + max.z) * 0.5f);
+            extent_x.push_back((max.x - min.x) * 0.5f);
+            extent_y.push_back((max.y - min.y) * 0.5f);
+            extent_z.push_back((max.z - min.z) * 0.5f);
+        }
+
+        [[nodiscard]]
+        std::size_t size() const noexcept {
+            return x.size();
+        }
+    };
+
+    namespace detail {
+        // Test of one object against all planes. A box is reduced to the sphere-like test
+        // with the radius being its extent projected onto the plane normal. Sums are
+        // taken in the order of the SIMD paths. Results of both are identical only
+        // if neither is contracted into FMAs, see -ffp-contract=off of culling_bench.
+        inline bool is_visible(frustum const& f, float const x, float const y, float const z,
+                               float const ex, float const ey, float const ez) noexcept {
+            for (auto const& p : f.planes) {
+                auto dist{x * p.x + p.w};
+                dist += y * p.y;
+                dist += z * p.z;
+
+                auto radius{ex * std::abs(p.x)};
+                radius += ey * std::abs(p.y);
+                radius += ez * std::abs(p.z);
+
+                if (dist < -radius)
+                    return false;
+            }
+            return true;
+        }
+
+        inline bool is_visible(frustum const& f, float const x, float const y, float const z, float const r) noexcept {
+            for (auto const& p : f.planes) {
+                auto dist{x * p.x + p.w};
+                dist += y * p.y;
+                dist += z * p.z;
+
+                if (dist < -r)
+                    return false;
+            }
+            return true;
+        }
+
+        // mask must not be zero
+        inline unsigned count_trailing_zeros(unsigned const mask) noexcept {
+#ifdef _MSC_VER
+            unsigned long idx;
+            _BitScanForward(&idx, mask);
+            return static_cast<unsigned>(idx);
+#else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
+
+        inline void push_mask(std::vector<std::uint32_t>& visible, std::size_t const base, unsigned mask) {
+            while (mask) {
+                auto const bit{count_trailing_zeros(mask)};
+                visible.push_back(static_cast<std::uint32_t>(base + bit));
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    inline void cull_spheres_scalar(frustum const& f, bounding_spheres const& spheres,
+                                    std::vector<std::uint32_t>& visible, std::size_t first = 0) {
+        for (auto i{first}; i < spheres.size(); ++i)
+            if (detail::is_visible(f, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]))
+                visible.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    inline void cull_boxes_scalar(frustum const& f, bounding_boxes const& boxes,
+                                  std::vector<std::uint32_t>& visible, std::size_t first = 0) {
+        for (auto i{first}; i < boxes.size(); ++i)
+            if (detail::is_visible(f, boxes.x[i], boxes.y[i], boxes.z[i],
+                                   boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]))
+                visible.push_back(static_cast<std::uint32_t>(i));
+    }
+
+#if defined(GL_HELPERS_CULLING_AVX2)
+    inline constexpr std::size_t culling_lanes{8};
+
+    inline void cull_spheres(frustum const& f, bounding_spheres const& spheres, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+
+        auto const cnt{spheres.size()};
+        std::size_t i{0};
+        for (; i + culling_lanes <= cnt; i += culling_lanes) {
+            auto const x{_mm256_loadu_ps(&spheres.x[i])};
+            auto const y{_mm256_loadu_ps(&spheres.y[i])};
+            auto const z{_mm256_loadu_ps(&spheres.z[i])};
+            auto const neg_r{_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]))};
+
+            auto inside{_mm256_castsi256_ps(_mm256_set1_epi32(-1))};
+            for (auto const& p : f.planes) {
+                auto dist{_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.x)), _mm256_set1_ps(p.w))};
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(y, _mm256_set1_ps(p.y)));
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(z, _mm256_set1_ps(p.z)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, neg_r, _CMP_GE_OQ));
+            }
+
+            detail::push_mask(visible, i, static_cast<unsigned>(_mm256_movemask_ps(inside)));
+        }
+
+        cull_spheres_scalar(f, spheres, visible, i);
+    }
+
+    inline void cull_boxes(frustum const& f, bounding_boxes const& boxes, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+
+        auto const cnt{boxes.size()};
+        std::size_t i{0};
+        for (; i + culling_lanes <= cnt; i += culling_lanes) {
+            auto const x{_mm256_loadu_ps(&boxes.x[i])};
+            auto const y{_mm256_loadu_ps(&boxes.y[i])};
+            auto const z{_mm256_loadu_ps(&boxes.z[i])};
+            auto const ex{_mm256_loadu_ps(&boxes.extent_x[i])};
+            auto const ey{_mm256_loadu_ps(&boxes.extent_y[i])};
+            auto const ez{_mm256_loadu_ps(&boxes.extent_z[i])};
+
+            auto inside{_mm256_castsi256_ps(_mm256_set1_epi32(-1))};
+            for (auto const& p : f.planes) {
+                auto dist{_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.x)), _mm256_set1_ps(p.w))};
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(y, _mm256_set1_ps(p.y)));
+                dist = _mm256_add_ps(dist, _mm256_mul_ps(z, _mm256_set1_ps(p.z)));
+
+                auto radius{_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(p.x)))};
+                radius = _mm256_add_ps(radius, _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(p.y))));
+                radius = _mm256_add_ps(radius, _mm256_mul_ps(ez, _mm256_set1_ps(std::abs(p.z))));
+
+                auto const neg_radius{_mm256_sub_ps(_mm256_setzero_ps(), radius)};
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, neg_radius, _CMP_GE_OQ));
+            }
+
+            detail::push_mask(visible, i, static_cast<unsigned>(_mm256_movemask_ps(inside)));
+        }
+
+        cull_boxes_scalar(f, boxes, visible, i);
+    }
+#elif defined(GL_HELPERS_CULLING_SSE)
+    inline constexpr std::size_t culling_lanes{4};
+
+    inline void cull_spheres(frustum const& f, bounding_spheres const& spheres, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+
+        auto const cnt{spheres.size()};
+        std::size_t i{0};
+        for (; i + culling_lanes <= cnt; i += culling_lanes) {
+            auto const x{_mm_loadu_ps(&spheres.x[i])};
+            auto const y{_mm_loadu_ps(&spheres.y[i])};
+            auto const z{_mm_loadu_ps(&spheres.z[i])};
+            auto const neg_r{_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]))};
+
+            auto inside{_mm_castsi128_ps(_mm_set1_epi32(-1))};
+            for (auto const& p : f.planes) {
+                auto dist{_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_set1_ps(p.w))};
+                dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(p.y)));
+                dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(p.z)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, neg_r));
+            }
+
+            detail::push_mask(visible, i, static_cast<unsigned>(_mm_movemask_ps(inside)));
+        }
+
+        cull_spheres_scalar(f, spheres, visible, i);
+    }
+
+    inline void cull_boxes(frustum const& f, bounding_boxes const& boxes, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+
+        auto const cnt{boxes.size()};
+        std::size_t i{0};
+        for (; i + culling_lanes <= cnt; i += culling_lanes) {
+            auto const x{_mm_loadu_ps(&boxes.x[i])};
+            auto const y{_mm_loadu_ps(&boxes.y[i])};
+            auto const z{_mm_loadu_ps(&boxes.z[i])};
+            auto const ex{_mm_loadu_ps(&boxes.extent_x[i])};
+            auto const ey{_mm_loadu_ps(&boxes.extent_y[i])};
+            auto const ez{_mm_loadu_ps(&boxes.extent_z[i])};
+
+            auto inside{_mm_castsi128_ps(_mm_set1_epi32(-1))};
+            for (auto const& p : f.planes) {
+                auto dist{_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_set1_ps(p.w))};
+                dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(p.y)));
+                dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(p.z)));
+
+                auto radius{_mm_mul_ps(ex, _mm_set1_ps(std::abs(p.x)))};
+                radius = _mm_add_ps(radius, _mm_mul_ps(ey, _mm_set1_ps(std::abs(p.y))));
+                radius = _mm_add_ps(radius, _mm_mul_ps(ez, _mm_set1_ps(std::abs(p.z))));
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_sub_ps(_mm_setzero_ps(), radius)));
+            }
+
+            detail::push_mask(visible, i, static_cast<unsigned>(_mm_movemask_ps(inside)));
+        }
+
+        cull_boxes_scalar(f, boxes, visible, i);
+    }
+#elif defined(GL_HELPERS_CULLING_NEON)
+    inline constexpr std::size_t culling_lanes{4};
+
+    namespace detail {
+        inline unsigned movemask(uint32x4_t const mask) noexcept {
+            static const std::uint32_t bits_arr[]{1, 2, 4, 8};
+            return vaddvq_u32(vandq_u32(mask, vld1q_u32(bits_arr)));
+        }
+    }
+
+    inline void cull_spheres(frustum const& f, bounding_spheres const& spheres, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+
+        auto const cnt{spheres.size()};
+        std::size_t i{0};
+        for (; i + culling_lanes <= cnt; i += culling_lanes) {
+            auto const x{vld1q_f32(&spheres.x[i])};
+            auto const y{vld1q_f32(&spheres.y[i])};
+            auto const z{vld1q_f32(&spheres.z[i])};
+            auto const neg_r{vnegq_f32(vld1q_f32(&spheres.radius[i]))};
+
+            auto inside{vdupq_n_u32(~0u)};
+            for (auto const& p : f.planes) {
+                auto dist{vmlaq_n_f32(vdupq_n_f32(p.w), x, p.x)};
+                dist = vmlaq_n_f32(dist, y, p.y);
+                dist = vmlaq_n_f32(dist, z, p.z);
+                inside = vandq_u32(inside, vcgeq_f32(dist, neg_r));
+            }
+
+            detail::push_mask(visible, i, detail::movemask(inside));
+        }
+
+        cull_spheres_scalar(f, spheres, visible, i);
+    }
+
+    inline void cull_boxes(frustum const& f, bounding_boxes const& boxes, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+
+        auto const cnt{boxes.size()};
+        std::size_t i{0};
+        for (; i + culling_lanes <= cnt; i += culling_lanes) {
+            auto const x{vld1q_f32(&boxes.x[i])};
+            auto const y{vld1q_f32(&boxes.y[i])};
+            auto const z{vld1q_f32(&boxes.z[i])};
+            auto const ex{vld1q_f32(&boxes.extent_x[i])};
+            auto const ey{vld1q_f32(&boxes.extent_y[i])};
+            auto const ez{vld1q_f32(&boxes.extent_z[i])};
+
+            auto inside{vdupq_n_u32(~0u)};
+            for (auto const& p : f.planes) {
+                auto dist{vmlaq_n_f32(vdupq_n_f32(p.w), x, p.x)};
+                dist = vmlaq_n_f32(dist, y, p.y);
+                dist = vmlaq_n_f32(dist, z, p.z);
+
+                auto radius{vmulq_n_f32(ex, std::abs(p.x))};
+                radius = vmlaq_n_f32(radius, ey, std::abs(p.y));
+                radius = vmlaq_n_f32(radius, ez, std::abs(p.z));
+
+                inside = vandq_u32(inside, vcgeq_f32(dist, vnegq_f32(radius)));
+            }
+
+            detail::push_mask(visible, i, detail::movemask(inside));
+        }
+
+        cull_boxes_scalar(f, boxes, visible, i);
+    }
+#else
+    inline constexpr std::size_t culling_lanes{1};
+
+    inline void cull_spheres(frustum const& f, bounding_spheres const& spheres, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+        cull_spheres_scalar(f, spheres, visible);
+    }
+
+    inline void cull_boxes(frustum const& f, bounding_boxes const& boxes, std::vector<std::uint32_t>& visible) {
+        visible.clear();
+        cull_boxes_scalar(f, boxes, visible);
+    }
+#endif
+}
+#endif
@@ -0,0 +1,79 @@
+#ifndef GL_SPSC_QUEUE__
+#define GL_SPSC_QUEUE__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace gl_helpers {
+
+    // Bounded lock-free queue for exactly one producer thread and one consumer thread.
+    // Indices grow monotonically and are wrapped with a mask, so CAPACITY has to be a power of two.
+    template<typename T, std::size_t CAPACITY>
+    class spsc_queue {
+    private:
+        static_assert(CAPACITY && !(CAPACITY & (CAPACITY - 1)), "spsc_queue capacity must be a power of two");
+        static_assert(std::is_trivially_copyable_v<T>, "spsc_queue may only hold trivially copyable data");
+
+        static constexpr std::size_t cache_line{64};
+
+        alignas(cache_line) std::atomic<std::size_t> head{0};
+        alignas(cache_line) std::atomic<std::size_t> tail{0};
+        alignas(cache_line) std::array<T, CAPACITY> items;
+
+    public:
+        spsc_queue() = default;
+        spsc_queue(spsc_queue const&) = delete;
+        spsc_queue& operator=(spsc_queue const&) = delete;
+
+        // Producer side. Returns false and drops the item when the queue is full.
+        bool push(T const& item) noexcept {
+            auto const tail_val{tail.load(std::memory_order_relaxed)};
+
+            if (tail_val - head.load(std::memory_order_acquire) == CAPACITY)
+                return false;
+
+            items[tail_val & (CAPACITY - 1)] = item;
+            tail.store(tail_val + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool pop(T& item) noexcept {
+            auto const head_val{head.load(std::memory_order_relaxed)};
+
+            if (head_val == tail.load(std::memory_order_acquire))
+                return false;
+
+            item = items[head_val & (CAPACITY - 1)];
+            head.store(head_val + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side. Hands over only items pushed before the call,
+        // so a fast producer cannot keep the consumer busy forever.
+        template<typename FUNC>
+        std::size_t consume_all(FUNC&& func) {
+            auto const head_val{head.load(std::memory_order_relaxed)};
+            auto const tail_val{tail.load(std::memory_order_acquire)};
+
+            for (auto i{head_val}; i != tail_val; ++i) {
+                func(items[i & (CAPACITY - 1)]);
+                head.store(i + 1, std::memory_order_release);
+            }
+
+            return tail_val - head_val;
+        }
+
+        [[nodiscard]]
+        bool empty() const noexcept {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        static constexpr std::size_t capacity() noexcept {
+            return CAPACITY;
+        }
+    };
+}
+#endif
@@ -1,15 +1,29 @@
 #include "gl_wrappers.hpp"
 #include "gl_helpers.hpp"
+#include "asset_archive.hpp"
+#include "camera.hpp"
+#include "gl_gpu_culling.hpp"
+#include "gl_ring_buffer.hpp"
+#include "frame_limiter.hpp"
+#include "bench_harness.hpp"
+#include "gl_hud.hpp"
+#include "gl_shader_reloader.hpp"
+#include "gl_gpu_profiler.hpp"
+#include "cpu_profiler.hpp"
+#include "async_logger.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-
-#define _USE_MATH_DEFINES
 #include <cmath>
 
+#include <array>
 #include <exception>
 #include <iostream>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <vector>
 
 using namespace gl_wrappers;
 
@@ -19,247 +33,24 @@ do {
         throw std::runtime_error(""s + msg + ": returned error code "s + std::to_string(err)); \
 } while(0)
 
-std::ostream &operator <<(std::ostream &o, glm::vec3 const &vec3) {
-    return o << '(' << vec3.x << ", " << vec3.y << ", " << vec3.z << ')';
-}
-using radian = double;
-
-class camera {
-private:
-    glm::vec3 position;
-    radian pitch;
-    radian yaw;
-    radian roll;
-    radian fov;
-public:
-
-    template<typename T>
-    camera(T&& start_pos = {}, radian pitch = 0.f, radian yaw = 0.f, radian roll = 0.f, radian fov = M_PI_2 / 2)
-            : position{std::forward<T>(start_pos)}, pitch{pitch}, yaw{yaw}, roll{roll}, fov{fov} {
-    }
-
-    radian get_fov() const {
-        return fov;
-    }
-
-    void set_fov(radian value) {
-        fov = value;
-    }
-
-    glm::vec3 get_pos_vec() const {
-        return position;
-    }
-
-    void set_pos_vec(glm::vec3 const& pos) {
-        position = pos;
-    }
-
-    void set_pos_vec(glm::vec3&& pos) {
-        position = pos;
-    }
-
-    void set_pitch(radian value) {
-        constexpr auto max{M_PI_2};
-        constexpr auto min{-M_PI_2};
-        if( min < value && value < max)
-            pitch = value;
-    }
-
-    radian get_pitch() const {
-        return pitch;
-    }
-
-    void set_yaw(radian value) {
-        yaw = value;
-    }
-
-    radian get_yaw() const {
-        return yaw;
-    }
-
-    void set_roll(radian value) {
-        roll = value;
-    }
-
-    radian get_roll() const {
-        return roll;
-    }
-
-    glm::vec3 get_direction_vec() const {
-        auto const pitch_val{get_pitch()};
-        auto const roll_val{get_roll()};
-        auto const yaw_val{get_yaw()};
-
-        auto const sin_pitch{std::sin(pitch_val)};
-        auto const cos_pitch{std::cos(pitch_val)};
-        auto const cos_roll{std::cos(roll_val)};
-        auto const sin_roll{std::sin(roll_val)};
-        auto const cos_yaw{std::cos(yaw_val)};
-        auto const sin_yaw{std::sin(yaw_val)};
-
-        glm::vec3&& vec{sin_pitch * sin_roll,
-                        sin_pitch * cos_roll,
-                        cos_pitch};
-
-        return glm::vec3{vec.x * cos_yaw - vec.z * sin_yaw,
-                         vec.y,
-                         vec.x * sin_yaw + vec.z * cos_yaw};
-    }
-
-    glm::vec3 get_up_vec() const {
-        auto const pitch_val{get_pitch()};
-        auto const roll_val{get_roll()};
-        auto const yaw_val{get_yaw()};
-
-        auto const sin_pitch{std::sin(pitch_val)};
-        auto const cos_pitch{std::cos(pitch_val)};
-        auto const cos_roll{std::cos(roll_val)};
-        auto const sin_roll{std::sin(roll_val)};
-        auto const cos_yaw{std::cos(yaw_val)};
-        auto const sin_yaw{std::sin(yaw_val)};
-
-        glm::vec3&& vec{sin_roll,
-                        cos_roll * cos_pitch,
-                        -sin_roll * sin_pitch};
-
-        return glm::vec3{vec.x * cos_yaw - vec.z * sin_yaw,
-                         vec.y,
-                         vec.x * sin_yaw + vec.z * cos_yaw};
-    }
-
-    void move_forward(float speed) {
-        set_pos_vec(get_pos_vec() - speed * get_direction_vec());
-    }
-
-    void move_backward(float speed) {
-        move_forward(-speed);
-    }
-
-    void move_to_right(float speed) {
-        glm::vec3&& diff_vec{speed * glm::cross(get_up_vec(), get_direction_vec())};
-        set_pos_vec(get_pos_vec() - diff_vec);
-    }
-
-    void move_to_left(float speed) {
-        move_to_right(-speed);
-    }
-
-    class camera_scroll_callback : public glfw_scroll_callback {
-    private:
-        camera& cam;
-    public:
-        camera_scroll_callback(camera& cam) : cam{cam}{};
-
-        virtual void operator() (glfw_window&, double, double y_off ) {
-            constexpr auto max_fov{M_PI_2};
-            constexpr auto min_fov{M_PI_2 / 180};
-
-            auto fov_new{cam.get_fov() - glm::radians(y_off)};
-
-            if (fov_new > max_fov)
-                fov_new = max_fov;
-            else if( fov_new < min_fov)
-                fov_new = min_fov;
-
-            cam.set_fov(fov_new);
-        }
-    } scroll_callback{*this};
-
-    class camera_key_callback : public glfw_key_callback {
-    private:
-        camera& cam;
-        static constexpr float speed{0.1f};
-    public:
-       camera_key_callback(camera& cam) : cam{cam}{};
-
-       virtual void operator() (glfw_window& window, int key, [[maybe_unused]]int scan_code, int action, [[maybe_unused]]int mode)
-       {
-           switch (key) {
-               case GLFW_KEY_ESCAPE:
-                   if (action == GLFW_PRESS)
-                       window.set_should_be_closed(true);
-                   break;
-               case GLFW_KEY_Q:
-                   if (action == GLFW_PRESS || action == GLFW_REPEAT)
-                       cam.set_roll(cam.get_roll() + 0.2f);
-                   break;
-               case GLFW_KEY_E:
-                   if (action == GLFW_PRESS || action == GLFW_REPEAT)
-                       cam.set_roll(cam.get_roll() - 0.2f);
-                   break;
-               case GLFW_KEY_W:
-                   if (action == GLFW_PRESS || action == GLFW_REPEAT)
-                       cam.move_forward(speed);
-                   break;
-               case GLFW_KEY_S:
-                   if (action == GLFW_PRESS || action == GLFW_REPEAT)
-                       cam.move_backward(speed);
-                   break;
-               case GLFW_KEY_A:
-                   if (action == GLFW_PRESS || action == GLFW_REPEAT)
-                       cam.move_to_right(speed);
-                   break;
-
-               case GLFW_KEY_D:
-                   if (action == GLFW_PRESS || action == GLFW_REPEAT)
-                       cam.move_to_left(speed);
-                   break;
-
-           }
-       }
-    } key_callback{*this};
-
-    class camera_cursor_pos_callback : public glfw_cursor_pos_callback {
-    private:
-        camera& cam;
-
-        double prev_x_pos{};
-        double prev_y_pos{};
-        bool call_once{true};
-
-        static constexpr float sensitivity{0.005f};
-    public:
-        camera_cursor_pos_callback(camera& cam) : cam{cam}{};
-
-        virtual void operator() (glfw_window&,  double x_pos, double y_pos)
-        {
-            if (call_once) {
-                prev_x_pos = x_pos;
-                prev_y_pos = y_pos;
-                call_once = false;
-            }
-
-            double const x_off{sensitivity * (x_pos - prev_x_pos)};
-            double const y_off{sensitivity * (prev_y_pos - y_pos)};
-
-            cam.set_yaw(cam.get_yaw() + x_off);
-            cam.set_pitch(cam.get_pitch() - y_off);
-
-            prev_x_pos = x_pos;
-            prev_y_pos = y_pos;
-        }
-    } cursor_pos_callback{*this};
-
-    glm::mat4 get_view() const {
-        auto const pos_vec{get_pos_vec()};
-
-        return glm::lookAt(pos_vec, pos_vec - get_direction_vec(), get_up_vec());
-    }
+struct options {
+    bool quaternion{false};
+    bool threaded{false};
+    bool late_latch{false};
+    int swap_interval{1};
+    double fps_limit{0.};
+    std::string cpu_trace_path;
+    std::string assets_path;
 };
 
-std::ostream &operator <<(std::ostream &o, camera const &cam) {
-    return o << "pos = " << cam.get_pos_vec() <<
-              "; direction = " << cam.get_direction_vec() <<
-              "; up = " << cam.get_up_vec() <<
-              "; roll = " << glm::degrees(cam.get_roll()) <<
-              "; pitch = " << glm::degrees(cam.get_pitch()) <<
-              "; yaw = " << glm::degrees(cam.get_yaw()) <<
-              "; fov = " << glm::degrees(cam.get_fov());
-}
+template<typename CAMERA, typename T>
+void main_loop(T&& window, options const& opts, bench_harness& harness) {
+    // Textures come from the archive if one is given, from the embedded resources otherwise
+    std::optional<gl_helpers::asset_archive> assets;
+    if (!opts.assets_path.empty())
+        assets.emplace(opts.assets_path);
 
-template<typename T>
-void main_loop(T&& window) {
-    auto load_texture = [](auto const texture_id, auto&& filename) {
+    auto load_texture = [&assets](texture_object& texture, auto&& filename) {
         auto get_color_model = [](unsigned channels_cnt) {
             switch (channels_cnt) {
                 case 3:
@@ -272,12 +63,16 @@ void main_loop(T&& window) {
             }
         };
 
-        auto [data, width, height, channels] =
-                gl_helpers::get_data_from_image(std::forward<decltype(filename)>(filename));
+        texture.set_label(filename);
+        auto [data, width, height, channels] = assets ?
+                gl_helpers::get_data_from_memory(assets->load(filename).get_bytes(), filename) :
+                gl_helpers::get_data_from_resource(gl_helpers::get_resource(filename));
 
-        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture.get_id());
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, get_color_model(channels), GL_UNSIGNED_BYTE, data.data());
         glGenerateMipmap(GL_TEXTURE_2D);
+        // Drivers keep RGB8 texels padded to 4 bytes
+        texture.set_size(texture_object::estimate_size(width, height, 4, true));
     };
     struct coordinate3D { GLfloat x, y, z; };
     struct rgb_color { GLfloat r, g, b; };
@@ -346,19 +141,21 @@ void main_loop(T&& window) {
             {-1.3f,  1.0f, -1.5f}
     };
 
-    GLuint vbo, vao, ebo, textures[2];
+    static auto const indices{[] {
+        std::array<GLuint, std::size(vertices)> arr{};
+        std::iota(std::begin(arr), std::end(arr), 0u);
+        return arr;
+    }()};
 
     glfw::set_context(std::forward<T>(window));
 
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glGenTextures(std::size(textures), textures);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    vertex_array_object vao;
+    buffer_object vbo, ebo;
+    texture_object textures[2];
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindVertexArray(vao.get_id());
+    vbo.set_data(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    ebo.set_data(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(), GL_STATIC_DRAW);
 
     load_texture(textures[0], "textures/wall.jpg");
     load_texture(textures[1], "textures/awesomeface.png");
@@ -371,76 +168,228 @@ void main_loop(T&& window) {
     glEnableVertexAttribArray(2);
 
 
-    shader_program program{vertex_shader{gl_helpers::get_text_from_file("shaders/simple.vert")},
-                           fragment_shader{gl_helpers::get_text_from_file("shaders/color.frag")}};
+    // Benchmark runs have to measure the same shaders from the first frame to the last
+    reloadable_program reloadable{{{GL_VERTEX_SHADER, "textured.vert", {{"MULTI_DRAW", ""},
+                                                                         {"MODEL_INDEX", "gl_BaseInstanceARB"}}},
+                                   {GL_FRAGMENT_SHADER, "textured.frag"}}, !harness.is_enabled()};
+    GLuint view_id, projection_id;
 
-    program.apply();
-    program.set_uniform<GLint>(program.get_uniform_id("uniform_texture0"), 0);
-    program.set_uniform<GLint>(program.get_uniform_id("uniform_texture1"), 1);
+    auto setup_program = [&](shader_program& program) {
+        program.apply();
+        program.set_uniform<GLint>(program.get_uniform_id("uniform_texture0"), 0);
+        program.set_uniform<GLint>(program.get_uniform_id("uniform_texture1"), 1);
 
-    auto const model_id{program.get_uniform_id("model")};
-    auto const view_id{program.get_uniform_id("view")};
-    auto const projection_id{program.get_uniform_id("projection")};
+        view_id = program.get_uniform_id("view");
+        projection_id = program.get_uniform_id("projection");
+    };
+    setup_program(reloadable.get());
 
-    auto get_model = [](float const phi, glm::vec3 const &pos) {
-        float const angle(glfw::get_time() * glm::radians(-55.0f) + phi);
+    auto get_model = [](double const time, float const phi, glm::vec3 const &pos) {
+        float const angle(time * glm::radians(-55.0f) + phi);
         return glm::rotate(glm::translate(glm::mat4{1.0f}, pos), angle, glm::vec3{1.f, 0.2f, 0.f});
     };
 
-    camera main_cam{glm::vec3{0.f, 0.f, 10.f}, glm::radians(0.f), glm::radians(0.f), glm::radians(0.f)};
-
-    struct callback_handler {
-        glfw_window &window;
-        glfw_key_callback        *prev_key_cb;
-        glfw_cursor_pos_callback *prev_cursor_pos_cb;
-        glfw_scroll_callback     *prev_scroll_cb;
-
-        callback_handler(glfw_window &w, camera &cam)
-                : window{w},
-                  prev_key_cb{window.set_key_callback(&cam.key_callback)},
-                  prev_cursor_pos_cb{window.set_cursor_pos_callback(&cam.cursor_pos_callback)},
-                  prev_scroll_cb{window.set_scroll_callback(&cam.scroll_callback)}
-        { }
-
-        ~callback_handler() {
-            window.set_key_callback(prev_key_cb);
-            window.set_cursor_pos_callback(prev_cursor_pos_cb);
-            window.set_scroll_callback(prev_scroll_cb);
-        }
-    } cb_handler{*window, main_cam};
+    CAMERA main_cam{glm::vec3{0.f, 0.f, 10.f}, glm::radians(0.f), glm::radians(0.f), glm::radians(0.f)};
 
-    window->disable_cursor();
+    // Events go straight to the camera, without the virtual callbacks of the window
+    camera_input<CAMERA> input{main_cam};
 
     auto get_projection = [window_ratio = window->get_width() / window->get_height()](radian fov) {
         return glm::perspective(static_cast<float>(fov), static_cast<float>(window_ratio), 0.1f, 100.0f);
     };
 
+    hiz_pyramid hiz{window->get_framebuffer_width(), window->get_framebuffer_height()};
+    gpu_culler culler{};
+    {
+        // Cubes rotate around their centers, so the bounding spheres never change
+        float const cube_radius{std::sqrt(3.f) * 0.5f};
+        std::vector<cull_instance> instances;
+
+        for (size_t i{0}; i < std::size(cube_positions); ++i) {
+            auto const& pos{cube_positions[i]};
+            instances.push_back({glm::vec4{pos, cube_radius},
+                                 {static_cast<GLuint>(std::size(indices)), 1, 0, 0, static_cast<GLuint>(i)}, {}});
+        }
+        culler.set_instances(instances);
+    }
+
+    // The models are the only allocation of a frame, at the aligned start of a region
+    auto const storage_alignment{static_cast<std::size_t>(ring_buffer::get_storage_alignment())};
+    std::array<glm::mat4, std::size(cube_positions)> models;
+    ring_buffer models_storage{sizeof(models)};
+
+    std::optional<gl_helpers::frame_limiter> limiter;
+    if (opts.fps_limit > 0.)
+        limiter.emplace(opts.fps_limit);
+
+    window->set_swap_interval(opts.swap_interval);
+
+    gpu_profiler profiler{};
+    hud overlay{window->get_framebuffer_width(), window->get_framebuffer_height()};
+
+    auto sample_input = [&] {
+        {
+            CPU_PROFILE_SCOPE("poll");
+            glfw::poll_events(input);
+        }
+        CPU_PROFILE_SCOPE("update");
+        main_cam.update(harness.get_clock().get_delta());
+    };
+
     glEnable(GL_DEPTH_TEST);
-    while(!window->should_be_closed()) {
+    while(!window->should_be_closed() && !harness.is_done()) {
+        CPU_PROFILE_SCOPE("frame");
+        harness.begin_frame();
+        profiler.begin_frame();
+        auto const time{harness.get_time()};
+
+        if (reloadable.update())
+            setup_program(reloadable.get());
+        auto& program{reloadable.get()};
+
+        if (!opts.late_latch)
+            sample_input();
+
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 
-        program.apply();
-        program.set_matrix_uniform<GLfloat, 4>(projection_id, 1, glm::value_ptr(get_projection(main_cam.get_fov())));
-        program.set_matrix_uniform<GLfloat, 4>(view_id, 1, glm::value_ptr(main_cam.get_view()));
-        for (size_t i{0}; i < std::size(cube_positions); ++i) {
-            program.set_matrix_uniform<GLfloat, 4>(model_id, 1, glm::value_ptr(get_model(20.f * i, cube_positions[i])));
-            glDrawArrays(GL_TRIANGLES, 0, std::size(vertices));
+        {
+            CPU_PROFILE_SCOPE("upload");
+            models_storage.begin_frame();
+            for (size_t i{0}; i < std::size(cube_positions); ++i)
+                models[i] = get_model(time, 20.f * i, cube_positions[i]);
+            auto const models_offset{models_storage.push(models.data(), models.size(), storage_alignment)};
+            models_storage.bind_range(GL_SHADER_STORAGE_BUFFER, 0, models_offset, sizeof(models));
+        }
+
+        // Late latch: everything not depending on the camera is already issued,
+        // so input is sampled as close to the submission as possible
+        if (opts.late_latch) {
+            if (limiter)
+                limiter->wait();
+            sample_input();
         }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        auto const projection{get_projection(main_cam.get_fov())};
+        auto const view{main_cam.get_view()};
+        auto const view_projection{projection * view};
+
+        {
+            CPU_PROFILE_SCOPE("cull");
+            gpu_profiler::scope const cull_scope{profiler, "cull"};
+            culler.cull(view_projection, &hiz);
+        }
 
-        std::cout << main_cam << std::endl;
-        glfw::poll_events();
-        window->swap_buffers();
+        {
+            CPU_PROFILE_SCOPE("submit");
+            gpu_profiler::scope const draw_scope{profiler, "draw"};
+            program.apply();
+            program.set_matrix_uniform<GLfloat, 4>(projection_id, 1, glm::value_ptr(projection));
+            program.set_matrix_uniform<GLfloat, 4>(view_id, 1, glm::value_ptr(view));
+            culler.draw();
+        }
+        models_storage.end_frame();
+
+        {
+            CPU_PROFILE_SCOPE("hiz");
+            gpu_profiler::scope const hiz_scope{profiler, "hiz"};
+            hiz.build(view_projection);
+        }
+
+        bind_texture(0, GL_TEXTURE_2D, textures[0].get_id());
+        bind_texture(1, GL_TEXTURE_2D, textures[1].get_id());
+
+        auto const stats{culler.get_stats()};
+        auto const& latency{window->get_input_latency()};
+        GL_LOG_EVERY(std::chrono::milliseconds{250}, info,
+                     main_cam, "; drawn = ", stats.drawn, '/', stats.instances,
+                     "; frustum culled = ", stats.frustum_culled,
+                     "; occlusion culled = ", stats.occlusion_culled,
+                     "; input latency = ", latency.last * 1e3, " ms (avg ", latency.avg * 1e3,
+                     ", max ", latency.max * 1e3, ')');
+        if (!harness.is_enabled()) {
+            CPU_PROFILE_SCOPE("hud");
+            gpu_profiler::scope const hud_scope{profiler, "hud"};
+            overlay.draw();
+        }
+        {
+            CPU_PROFILE_SCOPE("swap");
+            window->swap_buffers();
+        }
+        harness.end_frame();
+
+        if (limiter && !opts.late_latch)
+            limiter->wait();
     }
+
+    harness.finish();
+
+    for (auto const& [name, scope_stats] : profiler.get_all_stats())
+        GL_LOG(info, "GPU ", name, ": min ", scope_stats.min_ms, " ms, avg ", scope_stats.avg_ms,
+                     " ms, p99 ", scope_stats.p99_ms, " ms over ", scope_stats.samples, " frames");
+}
+
+template<typename CAMERA>
+void run(options const& opts, bench_harness& harness) {
+    auto window{glfw::create_window("textures", 800, 800)};
+
+    // Input modes may be changed only from the main thread
+    window->disable_cursor();
+    window->set_raw_mouse_motion(true);
+    window->set_cursor_input(glfw_window::cursor_input::coalesced);
+
+    CPU_PROFILE_THREAD_NAME("main");
+
+    if (opts.threaded)
+        glfw::run_render_thread(window, [&] {
+            CPU_PROFILE_THREAD_NAME("render");
+            main_loop<CAMERA>(window, opts, harness);
+        });
+    else
+        main_loop<CAMERA>(window, opts, harness);
+
+    if (!opts.cpu_trace_path.empty())
+        gl_helpers::cpu_profiler::write_chrome_trace(opts.cpu_trace_path);
 }
 
-int main() try {
-    main_loop(glfw::create_window("textures", 800, 800));
+int main(int argc, char *argv[]) try {
+    options opts;
+    bench_harness harness{"camera", argc, argv};
+
+    for (int i{1}; i < argc; ++i) {
+        if (auto const harness_args_cnt{bench_harness::get_option_args_cnt(argv[i])}) {
+            i += harness_args_cnt - 1;
+            continue;
+        }
+
+        auto next_arg = [&] {
+            if (i + 1 == argc)
+                throw std::runtime_error("Missing value for "s + argv[i]);
+            return std::string{argv[++i]};
+        };
+
+        if (argv[i] == "--quaternion"s)
+            opts.quaternion = true;
+        else if (argv[i] == "--threaded"s)
+            opts.threaded = true;
+        else if (argv[i] == "--late-latch"s)
+            opts.late_latch = true;
+        else if (argv[i] == "--swap-interval"s)
+            opts.swap_interval = std::stoi(next_arg());
+        else if (argv[i] == "--fps-limit"s)
+            opts.fps_limit = std::stod(next_arg());
+        else if (argv[i] == "--cpu-trace"s)
+            opts.cpu_trace_path = next_arg();
+        else if (argv[i] == "--assets"s)
+            opts.assets_path = next_arg();
+        else
+            throw std::runtime_error("Unknown option "s + argv[i]);
+    }
+
+    if (opts.quaternion)
+        run<quat_camera>(opts, harness);
+    else
+        run<camera>(opts, harness);
     return EXIT_SUCCESS;
 } catch (std::exception const& e) {
     std::cerr << "Exception in main: " << e.what() << std::endl;
@@ -1,13 +1,20 @@
 #include "gl_wrappers.hpp"
 #include "gl_helpers.hpp"
+#include "shader_preprocessor.hpp"
+#include "bench_harness.hpp"
+#include "gl_hud.hpp"
+#include "async_logger.hpp"
+#include "gl_batch_renderer.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 
+#include <array>
 #include <exception>
 #include <iostream>
+#include <numeric>
 
 using namespace gl_wrappers;
 
@@ -18,8 +25,8 @@ do {
 } while(0);
 
 template<typename T>
-void main_loop(T&& window) {
-    auto load_texture = [](auto const texture_id, auto&& filename) {
+void main_loop(T&& window, bench_harness& harness) {
+    auto load_texture = [](texture_object& texture, auto&& filename) {
         auto get_color_model = [](unsigned channels_cnt) {
             switch (channels_cnt) {
                 case 3:
@@ -34,12 +41,15 @@ void main_loop(T&& window) {
             }
         };
 
+        texture.set_label(filename);
         auto [data, width, height, channels] =
-                gl_helpers::get_data_from_image(std::forward<decltype(filename)>(filename));
+                gl_helpers::get_data_from_resource(gl_helpers::get_resource(filename));
 
-        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture.get_id());
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, get_color_model(channels), GL_UNSIGNED_BYTE, data.data());
         glGenerateMipmap(GL_TEXTURE_2D);
+        // Drivers keep RGB8 texels padded to 4 bytes
+        texture.set_size(texture_object::estimate_size(width, height, 4, true));
     };
     struct coordinate3D { GLfloat x, y, z; };
     struct rgb_color { GLfloat r, g, b; };
@@ -108,19 +118,21 @@ void main_loop(T&& window) {
             {-1.3f,  1.0f, -1.5f}
     };
 
-    GLuint vbo, vao, ebo, textures[2];
+    static auto const indices{[] {
+        std::array<GLuint, std::size(vertices)> arr{};
+        std::iota(std::begin(arr), std::end(arr), 0u);
+        return arr;
+    }()};
 
     glfw::set_context(std::forward<T>(window));
 
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glGenTextures(std::size(textures), textures);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    vertex_array_object vao;
+    buffer_object vbo, ebo;
+    texture_object textures[2];
 
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindVertexArray(vao.get_id());
+    vbo.set_data(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    ebo.set_data(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(), GL_STATIC_DRAW);
 
     load_texture(textures[0], "textures/wall.jpg");
     load_texture(textures[1], "textures/awesomeface.png");
@@ -133,19 +145,23 @@ void main_loop(T&& window) {
     glEnableVertexAttribArray(2);
 
 
-    shader_program program{vertex_shader{gl_helpers::get_text_from_file("shaders/simple.vert")},
-                           fragment_shader{gl_helpers::get_text_from_file("shaders/color.frag")}};
+    gl_helpers::shader_preprocessor const preprocessor;
+    auto const& textured_variant{preprocessor.get_variant("textured.vert", {{"MULTI_DRAW", ""},
+                                                                             {"MODEL_INDEX", "gl_DrawIDARB"}})};
+    shader_program program{vertex_shader{textured_variant.source},
+                           fragment_shader{preprocessor.get_variant("textured.frag").source}};
 
     program.apply();
     program.set_uniform<GLint>(program.get_uniform_id("uniform_texture0"), 0);
     program.set_uniform<GLint>(program.get_uniform_id("uniform_texture1"), 1);
 
-    auto const model_id{program.get_uniform_id("model")};
+    hud overlay{window->get_framebuffer_width(), window->get_framebuffer_height()};
+
     auto const view_id{program.get_uniform_id("view")};
     auto const projection_id{program.get_uniform_id("projection")};
 
-    auto get_model = [](float const phi, glm::vec3 const &pos) {
-        float const angle(glfw::get_time() * glm::radians(-55.0f) + phi);
+    auto get_model = [](double const time, float const phi, glm::vec3 const &pos) {
+        float const angle(time * glm::radians(-55.0f) + phi);
         return glm::rotate(glm::translate(glm::mat4{1.0f}, pos), angle, glm::vec3{1.f, 0.2f, 0.f});
     };
 
@@ -160,31 +176,42 @@ void main_loop(T&& window) {
     program.set_matrix_uniform<GLfloat, 4>(view_id, 1, glm::value_ptr(get_view()));
     program.set_matrix_uniform<GLfloat, 4>(projection_id, 1, glm::value_ptr(get_projection()));
 
+    batch_renderer<glm::mat4> batch{std::size(cube_positions)};
+
     glEnable(GL_DEPTH_TEST);
-    while(!window->should_be_closed()) {
+    while(!window->should_be_closed() && !harness.is_done()) {
+        harness.begin_frame();
+        auto const time{harness.get_time()};
+
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
 
         program.apply();
         for (size_t i{0}; i < std::size(cube_positions); ++i) {
-            std::cerr << i << std::endl;
-            program.set_matrix_uniform<GLfloat, 4>(model_id, 1, glm::value_ptr(get_model(20.f * i, cube_positions[i])));
-            glDrawArrays(GL_TRIANGLES, 0, std::size(vertices));
+            GL_LOG(debug, "batching cube ", i);
+            batch.add(std::size(indices), 0, 0, get_model(time, 20.f * i, cube_positions[i]));
         }
+        batch.submit();
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        bind_texture(0, GL_TEXTURE_2D, textures[0].get_id());
+        bind_texture(1, GL_TEXTURE_2D, textures[1].get_id());
 
+        if (!harness.is_enabled())
+            overlay.draw();
 
         glfw::poll_events();
         window->swap_buffers();
+
+        harness.end_frame();
     }
+
+    harness.finish();
 }
 
-int main() try {
-    main_loop(glfw::create_window("textures"));
+int main(int argc, char *argv[]) try {
+    bench_harness harness{"coord_systems", argc, argv};
+
+    main_loop(glfw::create_window("textures"), harness);
     return EXIT_SUCCESS;
 } catch (std::exception const& e) {
     std::cerr << "Exception in main: " << e.what() << std::endl;
@@ -1,5 +1,6 @@
 #include "gl_wrappers.hpp"
 #include "gl_helpers.hpp"
+#include "shader_preprocessor.hpp"
 
 #include <exception>
 #include <iostream>
@@ -34,8 +35,9 @@ void main_loop(T&& window) {
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), reinterpret_cast<void *>(offsetof(vertex, color)));
     glEnableVertexAttribArray(1);
 
-    shader_program program{vertex_shader{gl_helpers::get_text_from_file("shaders/simple.vert")},
-                           fragment_shader{gl_helpers::get_text_from_file("shaders/color.frag")}};
+    gl_helpers::shader_preprocessor const preprocessor;
+    shader_program program{vertex_shader{preprocessor.get_variant("position.vert").source},
+                           fragment_shader{preprocessor.get_variant("solid.frag").source}};
 
 
     GLuint uniform_color{program.get_uniform_id("color")};
@@ -1,8 +0,0 @@
-#version 430 core
-
-layout (location = 0) in vec3 pos;
-
-void main()
-{
-    gl_Position = vec4(pos, 1.0);
-}
@@ -1,8 +0,0 @@
-#version 330 core
-
-out vec4 frag_colour;
-
-void main(void)
-{
-    frag_colour = vec4(1.0f, 0.5f, 0.2f, 1.0f);
-}
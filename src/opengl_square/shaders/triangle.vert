@@ -1,7 +0,0 @@
-#version 430 core
-
-layout (location = 0) in vec3 position;
-
-void main(void) {
-    gl_Position = vec4(position.x, position.y, position.z, 1.0);
-}
@@ -1,5 +1,8 @@
 #include "gl_wrappers.hpp"
 #include "gl_helpers.hpp"
+#include "shader_preprocessor.hpp"
+#include "bench_harness.hpp"
+#include "gl_hud.hpp"
 
 #include <exception>
 #include <iostream>
@@ -13,8 +16,8 @@ do {
 } while(0);
 
 template<typename T>
-void main_loop(T&& window) {
-    auto load_texture = [](auto const texture_id, auto&& filename) {
+void main_loop(T&& window, bench_harness& harness) {
+    auto load_texture = [](texture_object& texture, auto&& filename) {
         auto get_color_model = [](unsigned channels_cnt) {
             switch (channels_cnt) {
                 case 3:
@@ -29,12 +32,15 @@ void main_loop(T&& window) {
             }
         };
 
+        texture.set_label(filename);
         auto [data, width, height, channels] =
-                gl_helpers::get_data_from_image(std::forward<decltype(filename)>(filename));
+                gl_helpers::get_data_from_resource(gl_helpers::get_resource(filename));
 
-        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture.get_id());
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, get_color_model(channels), GL_UNSIGNED_BYTE, data.data());
         glGenerateMipmap(GL_TEXTURE_2D);
+        // Drivers keep RGB8 texels padded to 4 bytes
+        texture.set_size(texture_object::estimate_size(width, height, 4, true));
     };
     struct coordinate3D { GLfloat x, y, z; };
     struct rgb_color { GLfloat r, g, b; };
@@ -57,21 +63,15 @@ void main_loop(T&& window) {
         1, 2, 3
     };
 
-    GLuint vbo, vao, ebo, textures[2];
-
     glfw::set_context(std::forward<T>(window));
 
+    vertex_array_object vao;
+    buffer_object vbo, ebo;
+    texture_object textures[2];
 
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glGenTextures(std::size(textures), textures);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBindVertexArray(vao.get_id());
+    vbo.set_data(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    ebo.set_data(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     load_texture(textures[0], "textures/wall.jpg");
     load_texture(textures[1], "textures/awesomeface.png");
@@ -85,32 +85,44 @@ void main_loop(T&& window) {
     glEnableVertexAttribArray(2);
 
 
-    shader_program program{vertex_shader{gl_helpers::get_text_from_file("shaders/simple.vert")},
-                           fragment_shader{gl_helpers::get_text_from_file("shaders/color.frag")}};
+    gl_helpers::shader_preprocessor const preprocessor;
+    shader_program program{vertex_shader{preprocessor.get_variant("textured.vert").source},
+                           fragment_shader{preprocessor.get_variant("textured.frag").source}};
 
     program.apply();
     program.set_uniform<GLint>(program.get_uniform_id("uniform_texture0"), 0);
     program.set_uniform<GLint>(program.get_uniform_id("uniform_texture1"), 1);
 
-    while(!window->should_be_closed()) {
+    hud overlay{window->get_framebuffer_width(), window->get_framebuffer_height()};
+
+    while(!window->should_be_closed() && !harness.is_done()) {
+        harness.begin_frame();
+
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        bind_texture(0, GL_TEXTURE_2D, textures[0].get_id());
+        bind_texture(1, GL_TEXTURE_2D, textures[1].get_id());
 
         program.apply();
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        draw_elements(GL_TRIANGLES, 6, GL_UNSIGNED_INT);
+
+        if (!harness.is_enabled())
+            overlay.draw();
 
         glfw::poll_events();
         window->swap_buffers();
+
+        harness.end_frame();
     }
+
+    harness.finish();
 }
 
-int main() try {
-    main_loop(glfw::create_window("textures"));
+int main(int argc, char *argv[]) try {
+    bench_harness harness{"texture", argc, argv};
+
+    main_loop(glfw::create_window("textures"), harness);
     return EXIT_SUCCESS;
 } catch (std::exception const& e) {
     std::cerr << "Exception in main: " << e.what() << std::endl;
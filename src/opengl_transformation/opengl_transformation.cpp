@@ -1,5 +1,9 @@
 #include "gl_wrappers.hpp"
 #include "gl_helpers.hpp"
+#include "shader_preprocessor.hpp"
+#include "bench_harness.hpp"
+#include "gl_hud.hpp"
+#include "async_logger.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
@@ -18,8 +22,8 @@ do {
 } while(0);
 
 template<typename T>
-void main_loop(T&& window) {
-    auto load_texture = [](auto const texture_id, auto&& filename) {
+void main_loop(T&& window, bench_harness& harness) {
+    auto load_texture = [](texture_object& texture, auto&& filename) {
         auto get_color_model = [](unsigned channels_cnt) {
             switch (channels_cnt) {
                 case 3:
@@ -34,12 +38,15 @@ void main_loop(T&& window) {
             }
         };
 
+        texture.set_label(filename);
         auto [data, width, height, channels] =
-                gl_helpers::get_data_from_image(std::forward<decltype(filename)>(filename));
+                gl_helpers::get_data_from_resource(gl_helpers::get_resource(filename));
 
-        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture.get_id());
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, get_color_model(channels), GL_UNSIGNED_BYTE, data.data());
         glGenerateMipmap(GL_TEXTURE_2D);
+        // Drivers keep RGB8 texels padded to 4 bytes
+        texture.set_size(texture_object::estimate_size(width, height, 4, true));
     };
     struct coordinate3D { GLfloat x, y, z; };
     struct rgb_color { GLfloat r, g, b; };
@@ -62,21 +69,15 @@ void main_loop(T&& window) {
         1, 2, 3
     };
 
-    GLuint vbo, vao, ebo, textures[2];
-
     glfw::set_context(std::forward<T>(window));
 
+    vertex_array_object vao;
+    buffer_object vbo, ebo;
+    texture_object textures[2];
 
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glGenTextures(std::size(textures), textures);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBindVertexArray(vao.get_id());
+    vbo.set_data(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    ebo.set_data(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     load_texture(textures[0], "textures/wall.jpg");
     load_texture(textures[1], "textures/awesomeface.png");
@@ -90,56 +91,69 @@ void main_loop(T&& window) {
     glEnableVertexAttribArray(2);
 
 
-    shader_program program{vertex_shader{gl_helpers::get_text_from_file("shaders/simple.vert")},
-                           fragment_shader{gl_helpers::get_text_from_file("shaders/color.frag")}};
+    gl_helpers::shader_preprocessor const preprocessor;
+    shader_program program{vertex_shader{preprocessor.get_variant("textured.vert", {{"TRANSFORMED", ""}}).source},
+                           fragment_shader{preprocessor.get_variant("textured.frag").source}};
 
     program.apply();
     program.set_uniform<GLint>(program.get_uniform_id("uniform_texture0"), 0);
     program.set_uniform<GLint>(program.get_uniform_id("uniform_texture1"), 1);
 
+    hud overlay{window->get_framebuffer_width(), window->get_framebuffer_height()};
+
     auto const transform_id{program.get_uniform_id("transform")};
     glm::mat4 matrix{1.0f};
-    auto transform1 = [](auto &mat) {
+    auto transform1 = [](auto &mat, double const time) {
         mat = glm::mat4{1.0f};
         mat = glm::translate(mat, glm::vec3{0.5f, -0.5f, 0});
-        mat = glm::rotate(mat, static_cast<float>(glfw::get_time()), glm::vec3{0, 0, 1.f});
+        mat = glm::rotate(mat, static_cast<float>(time), glm::vec3{0, 0, 1.f});
     };
 
-    auto transform2 = [](auto &mat) {
-        float scale_val(std::sin(glfw::get_time()));
+    auto transform2 = [](auto &mat, double const time) {
+        float scale_val(std::sin(time));
 
-        std::cout << (1.f + scale_val) / 2<< std::endl;
+        GL_LOG_EVERY(std::chrono::milliseconds{250}, info, "scale = ", (1.f + scale_val) / 2);
         mat = glm::mat4{(1.f + scale_val) / 2};
         mat[3][3] = 1;
     };
 
-    while(!window->should_be_closed()) {
+    while(!window->should_be_closed() && !harness.is_done()) {
+        harness.begin_frame();
+        auto const time{harness.get_time()};
+
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        bind_texture(0, GL_TEXTURE_2D, textures[0].get_id());
+        bind_texture(1, GL_TEXTURE_2D, textures[1].get_id());
 
 
         program.apply();
 
-        transform1(matrix);
+        transform1(matrix, time);
         program.set_matrix_uniform<GLfloat, 4>(transform_id, 1, glm::value_ptr(matrix));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        draw_elements(GL_TRIANGLES, 6, GL_UNSIGNED_INT);
 
-        transform2(matrix);
+        transform2(matrix, time);
         program.set_matrix_uniform<GLfloat, 4>(transform_id, 1, glm::value_ptr(matrix));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        draw_elements(GL_TRIANGLES, 6, GL_UNSIGNED_INT);
+
+        if (!harness.is_enabled())
+            overlay.draw();
 
         glfw::poll_events();
         window->swap_buffers();
+
+        harness.end_frame();
     }
+
+    harness.finish();
 }
 
-int main() try {
-    main_loop(glfw::create_window("textures"));
+int main(int argc, char *argv[]) try {
+    bench_harness harness{"transformation", argc, argv};
+
+    main_loop(glfw::create_window("textures"), harness);
     return EXIT_SUCCESS;
 } catch (std::exception const& e) {
     std::cerr << "Exception in main: " << e.what() << std::endl;
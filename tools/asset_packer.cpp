@@ -0,0 +1,61 @@
+#include "asset_archive.hpp"
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Packs files into an archive read by gl_helpers::asset_archive, see cmake/asset_archive.cmake.
+//
+//   asset_packer <output> <base_dir> [--none|--lz4|--zstd] <file>...
+//
+// Relative file paths are taken from <base_dir>, entries are named by their
+// paths relative to it with '/' separators. A compression option applies to
+// the files following it, entries which do not get smaller are stored uncompressed.
+
+namespace {
+
+    using namespace gl_helpers;
+
+    std::vector<unsigned char> read_file(std::filesystem::path const& path) {
+        std::ifstream ifs{path, std::ios_base::binary};
+        if (!ifs)
+            throw std::runtime_error("Cannot open " + path.string());
+
+        return {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    }
+}
+
+int main(int argc, char *argv[]) try {
+    if (argc < 3)
+        throw std::runtime_error("Usage: asset_packer <output> <base_dir> [--none|--lz4|--zstd] <file>...");
+
+    std::filesystem::path const base_dir{argv[2]};
+    asset_archive_writer writer;
+    auto compression{asset_compression::none};
+
+    for (int i{3}; i < argc; ++i) {
+        std::string const arg{argv[i]};
+
+        if (arg == "--none") {
+            compression = asset_compression::none;
+        } else if (arg == "--lz4") {
+            compression = asset_compression::lz4;
+        } else if (arg == "--zstd") {
+            compression = asset_compression::zstd;
+        } else {
+            auto const path{std::filesystem::path{arg}.is_absolute() ? std::filesystem::path{arg} : base_dir / arg};
+            writer.add(path.lexically_relative(base_dir).generic_string(), read_file(path), compression);
+        }
+    }
+
+    writer.write(argv[1]);
+    return EXIT_SUCCESS;
+} catch (std::exception const& e) {
+    std::cerr << "asset_packer: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
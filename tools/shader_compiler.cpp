@@ -0,0 +1,176 @@
+#include "shader_preprocessor.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Build time half of the shader pipeline, see lib/CMakeLists.txt.
+//
+//   shader_compiler preprocess <manifest> <include_dir> <out_dir>
+//       writes every variant of the manifest to <out_dir>/variant_<index>.<stage>
+//   shader_compiler embed <manifest> <out_dir> <header> [--spirv]
+//       writes a header embedding the preprocessed variants and, with --spirv,
+//       their SPIR-V modules <out_dir>/variant_<index>.spv
+//
+// The manifest has one variant per line: the shader file followed by its
+// defines, NAME or NAME=VALUE, separated by ';'. Empty lines and lines
+// starting with '#' are skipped.
+
+namespace {
+
+    using namespace gl_helpers;
+
+    struct variant {
+        std::string file;
+        shader_defines defines;
+    };
+
+    std::string trim(std::string const& str) {
+        auto const begin{str.find_first_not_of(" \t\r")};
+        if (begin == std::string::npos)
+            return {};
+        return str.substr(begin, str.find_last_not_of(" \t\r") - begin + 1);
+    }
+
+    std::vector<variant> read_manifest(std::filesystem::path const& path) {
+        std::ifstream ifs{path};
+        if (!ifs)
+            throw std::runtime_error("Cannot open " + path.string());
+
+        std::vector<variant> variants;
+        for (std::string line; std::getline(ifs, line); ) {
+            line = trim(line);
+            if (line.empty() || line.front() == '#')
+                continue;
+
+            variant v;
+            std::size_t begin{0};
+            for (bool first{true}; begin != std::string::npos; first = false) {
+                auto const end{line.find(';', begin)};
+                auto const item{trim(line.substr(begin, end == std::string::npos ? end : end - begin))};
+                begin = end == std::string::npos ? end : end + 1;
+
+                if (first) {
+                    v.file = item;
+                } else if (auto const eq{item.find('=')}; eq == std::string::npos) {
+                    v.defines.emplace_back(item, "");
+                } else {
+                    v.defines.emplace_back(trim(item.substr(0, eq)), trim(item.substr(eq + 1)));
+                }
+            }
+            variants.push_back(std::move(v));
+        }
+        return variants;
+    }
+
+    std::filesystem::path get_variant_path(std::filesystem::path const& out_dir, std::size_t const idx,
+                                           std::filesystem::path const& extension) {
+        return out_dir / ("variant_" + std::to_string(idx) + extension.string());
+    }
+
+    void preprocess(std::filesystem::path const& manifest, std::filesystem::path const& include_dir,
+                    std::filesystem::path const& out_dir) {
+        shader_preprocessor const preprocessor{{include_dir}};
+        auto const variants{read_manifest(manifest)};
+
+        std::filesystem::create_directories(out_dir);
+        for (std::size_t i{0}; i < variants.size(); ++i) {
+            auto const& v{variants[i]};
+            auto const path{get_variant_path(out_dir, i, std::filesystem::path{v.file}.extension())};
+
+            std::ofstream ofs{path};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+            ofs << preprocessor.process(v.file, v.defines).source;
+        }
+    }
+
+    void embed(std::filesystem::path const& manifest, std::filesystem::path const& out_dir,
+               std::filesystem::path const& header, bool const with_spirv) {
+        static constexpr char const delimiter[]{"glsl"};
+
+        auto const variants{read_manifest(manifest)};
+
+        std::ofstream ofs{header};
+        ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+        ofs << "// Generated by shader_compiler from " << manifest.filename().string() << ", do not edit\n"
+               "#ifndef GL_EMBEDDED_SHADERS__\n"
+               "#define GL_EMBEDDED_SHADERS__\n\n"
+               "#include <cstddef>\n"
+               "#include <cstdint>\n"
+               "#include <string_view>\n\n"
+               "namespace gl_helpers::embedded_shaders {\n\n"
+               "    struct variant {\n"
+               "        std::string_view key;\n"
+               "        std::string_view source;\n"
+               "        // Null unless built with SPIRV_SHADERS\n"
+               "        std::uint32_t const *spirv;\n"
+               "        std::size_t spirv_size;\n"
+               "    };\n";
+
+        for (std::size_t i{0}; i < variants.size(); ++i) {
+            auto const& v{variants[i]};
+            auto const source{get_text_from_file(
+                    get_variant_path(out_dir, i, std::filesystem::path{v.file}.extension()).string())};
+
+            if (source.find(std::string{")"} + delimiter + '"') != std::string::npos)
+                throw std::runtime_error(v.file + " cannot be embedded into a raw string literal");
+
+            ofs << "\n    inline constexpr char source_" << i << "[] = R\"" << delimiter << '(' << source <<
+                   ')' << delimiter << "\";\n";
+
+            if (!with_spirv)
+                continue;
+
+            auto const spirv_path{get_variant_path(out_dir, i, ".spv")};
+            std::ifstream spirv{spirv_path, std::ios_base::binary};
+            if (!spirv)
+                throw std::runtime_error("Cannot open " + spirv_path.string());
+
+            ofs << "    inline constexpr std::uint32_t spirv_" << i << "[] = {" << std::hex;
+            std::uint32_t word;
+            for (std::size_t j{0}; spirv.read(reinterpret_cast<char*>(&word), sizeof(word)); ++j)
+                ofs << (j % 8 ? " " : "\n        ") << "0x" << word << ',';
+            ofs << std::dec << "\n    };\n";
+        }
+
+        ofs << "\n    inline constexpr variant variants[] = {\n";
+        for (std::size_t i{0}; i < variants.size(); ++i) {
+            ofs << "        {\"";
+            for (auto const c : shader_preprocessor::get_permutation_key(variants[i].file, variants[i].defines)) {
+                if (c == '"' || c == '\\')
+                    ofs << '\\';
+                ofs << c;
+            }
+            ofs << "\", {source_" << i << ", sizeof(source_" << i << ") - 1}, ";
+            if (with_spirv)
+                ofs << "spirv_" << i << ", sizeof(spirv_" << i << ")},\n";
+            else
+                ofs << "nullptr, 0},\n";
+        }
+        ofs << "    };\n"
+               "}\n"
+               "#endif\n";
+    }
+}
+
+int main(int argc, char *argv[]) try {
+    std::string const mode{argc > 1 ? argv[1] : ""};
+
+    if (argc == 5 && mode == "preprocess")
+        preprocess(argv[2], argv[3], argv[4]);
+    else if ((argc == 5 || (argc == 6 && argv[5] == std::string{"--spirv"})) && mode == "embed")
+        embed(argv[2], argv[3], argv[4], argc == 6);
+    else
+        throw std::runtime_error("Usage: shader_compiler preprocess <manifest> <include_dir> <out_dir>\n"
+                                 "       shader_compiler embed <manifest> <out_dir> <header> [--spirv]");
+    return EXIT_SUCCESS;
+} catch (std::exception const& e) {
+    std::cerr << "shader_compiler: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+}